@@ -0,0 +1,83 @@
+/** \file
+ *
+ *  Saves the print progress to EEPROM, so a reset or a USB drop does not restart the
+ *  whole print. Saves rotate through CHECKPOINT_SLOTS slots for wear levelling.
+ */
+
+#include "Checkpoint.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <util/crc16.h>
+
+static Checkpoint_t EEMEM checkpoint_slots[CHECKPOINT_SLOTS];
+
+static uint8_t next_slot = 0;
+static uint16_t next_sequence = 0;
+
+static uint8_t Checkpoint_CRC(const Checkpoint_t* const Checkpoint)
+{
+	const uint8_t* bytes = (const uint8_t*)Checkpoint;
+	uint8_t crc = 0;
+
+	for (uint8_t i = 0; i < offsetof(Checkpoint_t, Check); i++)
+		crc = _crc8_ccitt_update(crc, bytes[i]);
+
+	return crc;
+}
+
+bool Checkpoint_Load(const uint16_t Tag, Checkpoint_t* const Checkpoint)
+{
+	bool found = false;
+	Checkpoint_t slot;
+
+	for (uint8_t i = 0; i < CHECKPOINT_SLOTS; i++)
+	{
+		eeprom_read_block(&slot, &checkpoint_slots[i], sizeof(Checkpoint_t));
+		if (slot.Check != Checkpoint_CRC(&slot))
+			continue;
+
+		// Sequence numbers wrap around, compare them as a signed distance.
+		if (!found || (int16_t)(slot.Sequence - Checkpoint->Sequence) > 0)
+		{
+			memcpy(Checkpoint, &slot, sizeof(Checkpoint_t));
+			next_slot = (i + 1) % CHECKPOINT_SLOTS;
+			found = true;
+		}
+	}
+
+	if (!found)
+	{
+		memset(Checkpoint, 0, sizeof(Checkpoint_t));
+		Checkpoint->Tag = Tag;
+		return false;
+	}
+
+	next_sequence = Checkpoint->Sequence + 1;
+
+	// A checkpoint from another image or from a finished print is not resumed.
+	if (Checkpoint->Tag != Tag || !(Checkpoint->Flags & CHECKPOINT_FLAG_VALID))
+	{
+		Checkpoint->Tag = Tag;
+		Checkpoint->Flags = 0;
+		return false;
+	}
+
+	return true;
+}
+
+void Checkpoint_Save(Checkpoint_t* const Checkpoint)
+{
+	Checkpoint->Sequence = next_sequence++;
+	Checkpoint->Check = Checkpoint_CRC(Checkpoint);
+
+	// Update only rewrites the bytes that changed, the sequence number and CRC at worst.
+	eeprom_update_block(Checkpoint, &checkpoint_slots[next_slot], sizeof(Checkpoint_t));
+	next_slot = (next_slot + 1) % CHECKPOINT_SLOTS;
+}
+
+void Checkpoint_Clear(Checkpoint_t* const Checkpoint)
+{
+	Checkpoint->Flags &= ~CHECKPOINT_FLAG_VALID;
+	Checkpoint_Save(Checkpoint);
+}
@@ -0,0 +1,44 @@
+/** \file
+ *
+ *  Header file for Checkpoint.c.
+ */
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+// Includes
+#include <avr/eeprom.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Macros
+// Number of EEPROM slots the checkpoint rotates through. Every save goes to the next slot,
+// so each EEPROM cell sees only 1/CHECKPOINT_SLOTS of the writes.
+#ifndef CHECKPOINT_SLOTS
+#define CHECKPOINT_SLOTS 8
+#endif
+
+#define CHECKPOINT_FLAG_VALID   0x01 // Cleared once the print is done, so it is not resumed again
+#define CHECKPOINT_FLAG_ERASING 0x02 // Correction mode was in its erasing pass
+
+// Type Defines
+// Print progress, enough to re-home the cursor and continue printing after a reset.
+typedef struct {
+	uint16_t Sequence; // Incremented on every save, the most recent valid slot wins
+	uint16_t Tag;      // Hash of the image and print settings this checkpoint belongs to
+	uint16_t XPos;
+	uint8_t  YPos;
+	uint8_t  Flags;    // See CHECKPOINT_FLAG_*
+	uint16_t PlanIndex; // Op of a plan to carry on from, with the cursor at XPos, YPos
+	uint8_t  Check;    // CRC8 of the bytes above, to detect torn or erased slots
+} Checkpoint_t;
+
+// Function Prototypes
+// Scan the EEPROM slots for the most recent checkpoint. Returns true if it is valid and matches Tag.
+bool Checkpoint_Load(const uint16_t Tag, Checkpoint_t* const Checkpoint);
+// Write the checkpoint to the next EEPROM slot.
+void Checkpoint_Save(Checkpoint_t* const Checkpoint);
+// Mark the print as finished, so the next power up starts from scratch.
+void Checkpoint_Clear(Checkpoint_t* const Checkpoint);
+
+#endif
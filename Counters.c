@@ -0,0 +1,147 @@
+/** \file
+ *
+ *  Performance counters and timing trace, for tuning the print speed without a debugger.
+ *  Build with -DPERF_COUNTERS and/or -DTIMING_TRACE and read them from the PC with
+ *  counters.py. They are answered to a GET_REPORT of their feature report. The report
+ *  descriptor is left as it is, so the Switch still sees the same controller.
+ */
+
+#include "Counters.h"
+
+#ifdef COUNTERS_TIMER
+
+static volatile uint16_t overflows = 0;
+
+ISR(TIMER1_OVF_vect)
+{
+	overflows++;
+}
+
+void Counters_Init(void)
+{
+	TCCR1A = 0;
+	TCCR1B = 1 << CS11;
+	TIMSK1 = 1 << TOIE1;
+}
+
+uint32_t Counters_Ticks(void)
+{
+	uint8_t sreg = SREG;
+	uint16_t low;
+	uint16_t high;
+
+	cli();
+	low = TCNT1;
+	high = overflows;
+	// The timer overflowed but the interrupt has not run yet
+	if ((TIFR1 & 1 << TOV1) && low < 0x8000)
+		high++;
+	SREG = sreg;
+
+	return (uint32_t)high << 16 | low;
+}
+
+#endif
+
+#ifdef COUNTERS_REPORTS
+
+static void Counters_Send(const void* const Report, const uint16_t Length)
+{
+	Endpoint_ClearSETUP();
+	Endpoint_Write_Control_Stream_LE(Report, Length);
+	Endpoint_ClearOUT();
+}
+
+void Counters_ControlRequest(void)
+{
+	if (USB_ControlRequest.bmRequestType != (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE)
+		|| USB_ControlRequest.bRequest != HID_REQ_GetReport
+		|| USB_ControlRequest.wValue >> 8 != COUNTERS_REPORT_TYPE_FEATURE)
+		return;
+
+#ifdef PERF_COUNTERS
+	if ((USB_ControlRequest.wValue & 0xFF) == COUNTERS_REPORT_ID)
+		Counters_Send(&counters, sizeof(counters));
+#endif
+#ifdef TIMING_TRACE
+	if ((USB_ControlRequest.wValue & 0xFF) == TIMING_REPORT_ID)
+		Counters_Send(&timing, sizeof(timing));
+#endif
+}
+
+#endif
+
+#ifdef PERF_COUNTERS
+
+Counters_t counters = {.ReportID = COUNTERS_REPORT_ID};
+
+static uint32_t last_report = 0;
+
+void Counters_Report(const uint32_t Start)
+{
+	uint32_t now = Counters_Ticks();
+	uint32_t cycles = (now - Start) * COUNTERS_CYCLES_PER_TICK;
+
+	counters.ReportCycles = cycles;
+	if (cycles > counters.MaxReportCycles)
+		counters.MaxReportCycles = cycles;
+
+	if (counters.Reports > 0)
+	{
+		uint32_t gap = Start - last_report;
+		uint32_t gap_us = gap / (COUNTERS_TICKS_PER_MS / 1000);
+
+		if (gap_us > counters.MaxGapUs)
+			counters.MaxGapUs = gap_us;
+		// Round to whole poll intervals, the host polls every POLLING_MS
+		if (gap > COUNTERS_TICKS_PER_MS * POLLING_MS * 3 / 2)
+			counters.MissedPolls += (gap + COUNTERS_TICKS_PER_MS * POLLING_MS / 2) / (COUNTERS_TICKS_PER_MS * POLLING_MS) - 1;
+	}
+	last_report = Start;
+	counters.Reports++;
+}
+
+#endif
+
+#ifdef TIMING_TRACE
+
+Timing_t timing = {.ReportID = TIMING_REPORT_ID, .Size = TIMING_TRACE_SIZE};
+
+static uint32_t last_poll = 0;
+static bool polled = false;
+static uint8_t last_state = 0xFF;
+
+static void Timing_Add(const uint32_t Time, const uint8_t Event, const uint8_t Data)
+{
+	timing.Events[timing.Next] = (TimingEvent_t){.Time = Time, .Event = Event, .Data = Data};
+	if (++timing.Next == TIMING_TRACE_SIZE)
+		timing.Next = 0;
+}
+
+void Timing_Poll(const uint32_t Now)
+{
+	if (polled)
+	{
+		uint32_t gap_us = (Now - last_poll) / (COUNTERS_TICKS_PER_MS / 1000);
+		uint8_t bucket = 0;
+
+		while (gap_us >>= 1)
+			bucket++;
+		if (bucket >= TIMING_BUCKETS)
+			bucket = TIMING_BUCKETS - 1;
+		timing.Histogram[bucket]++;
+	}
+	polled = true;
+	last_poll = Now;
+	Timing_Add(Now, TIMING_EVENT_POLL, 0);
+}
+
+void Timing_State(const uint8_t State)
+{
+	if (State == last_state)
+		return;
+	last_state = State;
+	Timing_Add(Counters_Ticks(), TIMING_EVENT_STATE, State);
+}
+
+#endif
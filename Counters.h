@@ -0,0 +1,125 @@
+/** \file
+ *
+ *  Header file for Counters.c.
+ */
+
+#ifndef _COUNTERS_H_
+#define _COUNTERS_H_
+
+// Includes
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Descriptors.h"
+
+// Macros
+// The counters, the timing trace and the UART telemetry all run from Timer1
+#if defined(PERF_COUNTERS) || defined(TIMING_TRACE) || defined(UART_TELEMETRY)
+#define COUNTERS_TIMER
+#endif
+// Of which the ones read with a GET_REPORT
+#if defined(PERF_COUNTERS) || defined(TIMING_TRACE)
+#define COUNTERS_REPORTS
+#endif
+
+// Feature reports the counters and the timing trace are read from, with a HID GET_REPORT on
+// the interface.
+#define COUNTERS_REPORT_ID 0x43
+#define TIMING_REPORT_ID   0x54
+
+// In the wValue of the GET_REPORT, the report type goes in the high byte.
+#define COUNTERS_REPORT_TYPE_FEATURE 0x03
+
+// Timer1 runs at F_CPU / 8.
+#define COUNTERS_CYCLES_PER_TICK 8
+#define COUNTERS_TICKS_PER_MS    (F_CPU / COUNTERS_CYCLES_PER_TICK / 1000)
+
+// Events kept in the timing trace ring (6 bytes each, mind the 512 bytes of SRAM of the 16u2).
+#ifndef TIMING_TRACE_SIZE
+#define TIMING_TRACE_SIZE 32
+#endif
+// Histogram buckets of inter-poll gaps, bucket n counts the gaps of 2^n to 2^(n+1) - 1 us.
+#define TIMING_BUCKETS 16
+
+#define TIMING_EVENT_POLL  0x01 // The host was ready for a report
+#define TIMING_EVENT_STATE 0x02 // GetNextReport went to the state in Data
+
+// Type Defines
+// Live performance counters, sent as is in the feature report.
+typedef struct {
+	uint8_t  ReportID;        // COUNTERS_REPORT_ID
+	uint32_t Reports;         // Reports sent since power up
+	uint32_t Echoes;          // Of which repeats of the previous report
+	uint32_t MissedPolls;     // Poll intervals the host let go by without taking a report
+	uint32_t MaxGapUs;        // Longest time between two reports
+	uint16_t XPos;            // Current pixel
+	uint8_t  YPos;
+	uint8_t  State;           // See State_t
+	uint32_t ReportCycles;    // CPU cycles spent in the last GetNextReport
+	uint32_t MaxReportCycles;
+} ATTR_PACKED Counters_t;
+
+typedef struct {
+	uint32_t Time;            // Timer1 ticks since power up
+	uint8_t  Event;           // TIMING_EVENT_*
+	uint8_t  Data;
+} ATTR_PACKED TimingEvent_t;
+
+// Timing trace, sent as is in the feature report and left in SRAM for simavr.
+typedef struct {
+	uint8_t  ReportID;        // TIMING_REPORT_ID
+	uint8_t  Size;            // TIMING_TRACE_SIZE
+	uint8_t  Next;            // Where the next event goes, the oldest one once the ring is full
+	uint32_t Histogram[TIMING_BUCKETS];
+	TimingEvent_t Events[TIMING_TRACE_SIZE];
+} ATTR_PACKED Timing_t;
+
+// Function Prototypes
+#ifdef COUNTERS_TIMER
+// Start Timer1.
+void Counters_Init(void);
+// Timer1 ticks since power up.
+uint32_t Counters_Ticks(void);
+#else
+#define Counters_Init()
+#define Counters_Ticks() 0
+#endif
+
+#ifdef COUNTERS_REPORTS
+// Answer the GET_REPORT for the counters or the timing trace, if that's what the control request is.
+void Counters_ControlRequest(void);
+#else
+#define Counters_ControlRequest()
+#endif
+
+#ifdef PERF_COUNTERS
+extern Counters_t counters;
+
+// Account a report whose GetNextReport started at Start (from Counters_Ticks).
+void Counters_Report(const uint32_t Start);
+
+#define Counters_Echo() (counters.Echoes++)
+#define Counters_Position(X, Y, S) \
+	do { counters.XPos = (X); counters.YPos = (Y); counters.State = (S); } while (0)
+#else
+// Without PERF_COUNTERS all of the above costs nothing
+#define Counters_Report(Start) ((void)(Start))
+#define Counters_Echo()
+#define Counters_Position(X, Y, S)
+#endif
+
+#ifdef TIMING_TRACE
+extern Timing_t timing;
+
+// The host is ready for a report at Now (from Counters_Ticks).
+void Timing_Poll(const uint32_t Now);
+// GetNextReport is in State now, only state changes are kept.
+void Timing_State(const uint8_t State);
+#else
+#define Timing_Poll(Now) ((void)(Now))
+#define Timing_State(State)
+#endif
+
+#endif
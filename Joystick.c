@@ -25,8 +25,18 @@ these buttons for our use.
  */
 
 #include "Joystick.h"
+// Pacing picked by sim/autotune.py, build with -DUSE_TUNING_HEADER to use it
+#ifdef USE_TUNING_HEADER
+#include "Tuning.h"
+#endif
 
 extern const uint8_t image_data[0x12c1] PROGMEM;
+extern const uint16_t patch_length;
+extern const uint8_t patch_data[] PROGMEM;
+extern const uint16_t plan_length;
+extern const uint8_t plan_data[] PROGMEM;
+extern const uint8_t queue_length;
+extern const uint8_t queue_data[] PROGMEM;
 
 
 
@@ -34,7 +44,82 @@ extern const uint8_t image_data[0x12c1] PROGMEM;
 // In order to initiate correction mode, add the lines that failed below like:
 // const int linesToCorrect[] = {9, 10, 68, 69};
 // Count the lines starting with 0.
+// Or let screen2c.py find them in a screenshot of the post, and build with -DUSE_CORRECTION_HEADER
+// to use the Correction.h it writes instead of the lists below.
+#ifdef USE_CORRECTION_HEADER
+#include "Correction.h"
+#else
 const int linesToCorrect[] = {};
+// To fix only part of some lines, add rectangles (inclusive, counting from 0) below like:
+// const CorrectionRect_t rectsToCorrect[] = {{.X0 = 40, .X1 = 95, .Y0 = 9, .Y1 = 12}};
+// Only the pixels inside are erased and re-inked.
+const CorrectionRect_t rectsToCorrect[] = {};
+#endif
+const int linesToCorrectLength = sizeof(linesToCorrect) / sizeof(int);
+const int rectsToCorrectLength = sizeof(rectsToCorrect) / sizeof(CorrectionRect_t);
+const bool inCorrectionMode = linesToCorrectLength > 0 || rectsToCorrectLength > 0;
+// Build with -DSINGLE_PASS_CORRECTION to fix each pixel in a single pass, pressing A on black
+// pixels and B on white ones, instead of erasing the whole span and re-inking it.
+// Build with -DLARGE_BRUSH_ERASE to erase bands of at least LARGE_BRUSH_SIZE adjacent lines
+// with a few strokes of the large brush, before re-inking them with the pixel brush.
+
+// ===== Patch mode ======
+// To only touch up some pixels, generate patch.c with patch2c.py. When the patch is not empty
+// the canvas is not cleared and only the pixels in the patch are inked or erased, in order.
+// Patch mode takes precedence over correction mode.
+
+// ===== Plan mode ======
+// To print with a route planned on the PC, compile plan.c with plan2c.py. When the plan is not
+// empty its moves are played back from a cleared canvas instead of going back and forth.
+// Patch mode takes precedence over plan mode, and plan mode over correction mode.
+
+// ===== Script mode ======
+// Build with -DSCRIPT_VM and assemble script.c with script2c.py to have a script send the
+// reports instead (see ScriptVM.h): syncing, printing and correcting are then ops of the script.
+// The lists above and image.c are still what the FIX, STEP and SPAN ops look at.
+
+// ===== Queue mode ======
+// To print several posts in one session, put the images to print after image.c in queue.c with
+// queue2c.py. After each post the printer waits QUEUE_DELAY_MS (or, built with -DQUEUE_TRIGGER,
+// for a button between QUEUE_TRIGGER_BIT of PORTB and ground), sends the reports below to save
+// the post and open a new canvas, then homes the cursor and prints the next image. The
+// controller is not paired again. Check the sequence on your console, it depends on where the
+// game leaves you after saving. Patches, plans and corrections are made for image.c alone, the
+// queue is ignored with any of them.
+const QueueStep_t queueSaveSequence[] = {
+	{.Button = SWITCH_PLUS, .Ms = 100}, {.Ms = 1500}, // Finish the post
+	{.Button = SWITCH_A, .Ms = 100}, {.Ms = 4000},    // Save it
+	{.Button = SWITCH_A, .Ms = 100}, {.Ms = 4000},    // Start a new one
+};
+const int queueSaveSequenceLength = sizeof(queueSaveSequence) / sizeof(QueueStep_t);
+#ifndef QUEUE_DELAY_MS
+#define QUEUE_DELAY_MS 5000
+#endif
+#ifndef QUEUE_TRIGGER_BIT
+#define QUEUE_TRIGGER_BIT PB1 // Pin 21 on the Teensy 2.0++, pin 3 of the ICSP header on the UNO and the Micro
+#endif
+#define in_queue_mode() (queue_length > 0 && patch_length == 0 && plan_length == 0 && !inCorrectionMode && state != SCRIPT)
+#ifdef QUEUE_TRIGGER
+#define queue_triggered() (!(PINB & 1 << QUEUE_TRIGGER_BIT))
+#else
+#define queue_triggered() (command_count > ms_2_count(QUEUE_DELAY_MS))
+#endif
+
+// ===== Checkpoint and resume ======
+// The progress is saved to EEPROM at the start of every CHECKPOINT_ROWS rows (a plan saves at
+// the start of its next op, once it moved up or down that many rows). After a reset, or when
+// the Switch drops the USB connection, the cursor is re-homed and the print continues from the
+// last checkpoint without clearing the canvas.
+#ifndef CHECKPOINT_ROWS
+#define CHECKPOINT_ROWS 4
+#endif
+
+Checkpoint_t checkpoint;
+bool resuming = false;
+bool inScriptMode = false; // Script_Init found a script, the state stays SCRIPT until it ends
+volatile bool needs_resync = false;
+
+State_t state = SYNC_CONTROLLER;
 
 
 
@@ -66,6 +151,21 @@ void SetupHardware(void)
 	clock_prescale_set(clock_div_1);
 
 	// We can then initialize our hardware and peripherals, including the USB stack.
+	// Look for an unfinished print before anything else.
+	SetupCorrection();
+#ifdef QUEUE_TRIGGER
+	// The trigger button pulls the pin low
+	DDRB &= ~(1 << QUEUE_TRIGGER_BIT);
+	PORTB |= 1 << QUEUE_TRIGGER_BIT;
+#endif
+	inScriptMode = Script_Init();
+	if (inScriptMode)
+		state = SCRIPT;
+	LoadCheckpoint();
+	Counters_Init();
+	Telemetry_Init((resuming ? TELEMETRY_FLAG_RESUMING : 0) | (inCorrectionMode ? TELEMETRY_FLAG_CORRECTION : 0)
+		| (patch_length > 0 ? TELEMETRY_FLAG_PATCH : 0) | (plan_length > 0 ? TELEMETRY_FLAG_PLAN : 0)
+		| (state == SCRIPT ? TELEMETRY_FLAG_SCRIPT : 0) | (in_queue_mode() ? TELEMETRY_FLAG_QUEUE : 0));
 
 	// The USB stack should be initialized last.
 	USB_Init();
@@ -81,6 +181,10 @@ void EVENT_USB_Device_Connect(void)
 void EVENT_USB_Device_Disconnect(void)
 {
 	// We can indicate that our device is not ready (via status LEDs, sound, etc.).
+
+	// The cursor can't be trusted anymore, resync and resume once we are back.
+	needs_resync = true;
+	Telemetry_Send(TELEMETRY_DISCONNECT, NULL, 0);
 }
 
 // Fired when the host set the current configuration of the USB device after enumeration.
@@ -101,6 +205,8 @@ void EVENT_USB_Device_ControlRequest(void)
 	// We can handle two control requests: a GetReport and a SetReport.
 
 	// Not used here, it looks like we don't receive control request from the Switch.
+	// The performance counters are read this way from a PC though.
+	Counters_ControlRequest();
 }
 
 // Process and deliver data from IN and OUT endpoints.
@@ -137,8 +243,12 @@ void HID_Task(void)
 	{
 		// We'll create an empty report.
 		USB_JoystickReport_Input_t JoystickInputData;
+		uint32_t start = Counters_Ticks();
+		Timing_Poll(start);
+		Telemetry_Poll(start);
 		// We'll then populate this report with what we want to send to the host.
 		GetNextReport(&JoystickInputData);
+		Counters_Report(start);
 		// Once populated, we can output this data to the host. We do this by first writing the data to the control stream.
 		Endpoint_Write_Stream_LE(&JoystickInputData, sizeof(JoystickInputData), NULL);
 		// We then send an IN packet on this endpoint.
@@ -146,15 +256,6 @@ void HID_Task(void)
 	}
 }
 
-typedef enum {
-	SYNC_CONTROLLER,
-	SYNC_POSITION,
-	MOVE,
-	STOP,
-	DONE
-} State_t;
-State_t state = SYNC_CONTROLLER;
-
 // Repeat ECHOES times the last sent report.
 //
 // This value is affected by several factors:
@@ -165,7 +266,26 @@ State_t state = SYNC_CONTROLLER;
 //   at more than 30 fps triggers pixel skipping).
 // In this case we will send 320 moves and 320 stops per line, using 3 reports for each
 // send, in around 15 s (thus 8 ms per report), updating the screen every 48 ms.
+#ifndef ECHOES
 #define ECHOES 2
+#endif
+// Reports that press the D-pad (moves) and the others (stops, sync) can be held for a
+// different number of echoes.
+#ifndef MOVE_ECHOES
+#define MOVE_ECHOES ECHOES
+#endif
+#ifndef STOP_ECHOES
+#define STOP_ECHOES ECHOES
+#endif
+
+// Time given to the Switch to pick up the controller, and to the stick to push the cursor to
+// the top left corner. The canvas is cleared and the brush selected during the latter.
+#ifndef SYNC_CONTROLLER_MS
+#define SYNC_CONTROLLER_MS 2000
+#endif
+#ifndef SYNC_POSITION_MS
+#define SYNC_POSITION_MS 4000
+#endif
 
 int echoes = 0;
 USB_JoystickReport_Input_t last_report;
@@ -176,13 +296,342 @@ int xpos = 0;
 int ypos = 0;
 int portsval = 0;
 
-const int linesToCorrectLength = sizeof(linesToCorrect) / sizeof(int);
-const bool inCorrectionMode = linesToCorrectLength > 0;
-bool isCorrectionModeErasing = true;
+typedef enum {
+	CORRECTION_SEEK,
+	CORRECTION_ERASE,
+	CORRECTION_INK,
+	CORRECTION_SET
+} CorrectionPhase_t;
+
+CorrectionPhase_t correctionPhase = CORRECTION_SEEK;
+
+// One bit per row that has anything to correct, so the lists are only looked at once per row
+uint8_t rowsToCorrect[120 / 8];
+// One bit per row from linesToCorrect[]
+uint8_t fullRowsToCorrect[120 / 8];
+// Span of the current row to correct, loaded when entering the row
+bool isLineThatNeedsCorrection = false;
+int correctionX0 = 0;
+int correctionX1 = 0;
+// The erase pass starts from the end of the span nearest to the cursor, the re-ink pass comes back
+int correctionStart = 0;
+int correctionEnd = 0;
+
+// Single pass correction also fixes this many pixels around the ink, in case lag shifted it sideways
+#ifndef CORRECTION_MARGIN
+#define CORRECTION_MARGIN 8
+#endif
+
+#ifdef LARGE_BRUSH_ERASE
+#ifdef SINGLE_PASS_CORRECTION
+#error "LARGE_BRUSH_ERASE needs the two pass correction"
+#endif
+
+// The large brush, counted in presses of R from the pixel brush, and its width in pixels.
+// Check these on your console: the brush must not reach outside the band it erases.
+#ifndef LARGE_BRUSH_STEPS
+#define LARGE_BRUSH_STEPS 2
+#endif
+#ifndef LARGE_BRUSH_SIZE
+#define LARGE_BRUSH_SIZE 7
+#endif
+// Time for the stick to take the cursor across the whole canvas
+#ifndef LARGE_BRUSH_STROKE_MS
+#define LARGE_BRUSH_STROKE_MS 1500
+#endif
+
+typedef enum {
+	BULK_BRUSH_UP,
+	BULK_HOME,
+	BULK_SEEK,
+	BULK_STROKE,
+	BULK_BRUSH_DOWN,
+	BULK_RETURN
+} BulkEraseStep_t;
+
+BulkEraseStep_t bulkStep = BULK_BRUSH_UP;
+bool bulkErasePending = false;
+int bulkY0 = 0;
+int bulkY1 = 0;
+int bulkStrokeY = 0;
+int bulkErasedY0 = -1; // First row of the last band erased, its rows only need to be re-inked
+#endif
+
+// Next pixel of the patch. Entries are 3 bytes: x low byte, x high bit | ink flag, y.
+#define PATCH_INK 0x80
+uint16_t patch_index = 0;
+int patchX = 0;
+int patchY = 0;
+bool patchInk = false;
+
+// Current op of the plan (see PLAN_* in Joystick.h).
+const uint8_t planHatTable[4] = {HAT_RIGHT, HAT_LEFT, HAT_BOTTOM, HAT_TOP};
+uint16_t plan_index = 0;
+uint8_t planOp = 0;
+uint8_t planArg = 0;
+uint8_t planSteps = 0;
+State_t planResumeState = MOVE; // The report that was due when the connection dropped
+uint16_t planResumePress = 0; // A or B of a press the drop cut off, sent again once back there
+bool planOpStart = false; // Nothing of the current op was sent yet
+uint8_t planRows = 0; // Rows moved up or down since the last checkpoint
+
+// Image being printed: image.c, then each image of queue.c. queueStep is the report of the
+// save sequence being sent, -1 while waiting for the next post.
+const uint8_t *current_image = image_data;
+uint8_t queue_index = 0;
+int queueStep = -1;
 
 #define max(a, b) (a > b ? a : b)
-#define ms_2_count(ms) (ms / ECHOES / (max(POLLING_MS, 8) / 8 * 8))
-#define is_black(x, y) (pgm_read_byte(&(image_data[((x) / 8) + ((y) * 40)])) & 1 << ((x) % 8))
+#define ms_2_count(ms) ((ms) / STOP_ECHOES / (max(POLLING_MS, 8) / 8 * 8))
+#define min(a, b) (a < b ? a : b)
+#define is_black(x, y) (pgm_read_byte(&(current_image[((x) / 8) + ((y) * 40)])) & 1 << ((x) % 8))
+#define hat_towards(x) ((x) > xpos ? HAT_RIGHT : (x) < xpos ? HAT_LEFT : HAT_CENTER)
+#define is_full_row_to_correct(y) (fullRowsToCorrect[(y) / 8] & 1 << ((y) % 8))
+
+// Leftmost and rightmost black pixels of a row, false if the row is blank.
+bool GetRowInkSpan(int y, int *x0, int *x1)
+{
+	int first = 0;
+	int last = 39;
+	uint8_t bits;
+
+	if (y < 0 || y > 119)
+		return false;
+	while (first < 40 && !pgm_read_byte(&current_image[first + y * 40]))
+		first++;
+	if (first == 40)
+		return false;
+	while (!pgm_read_byte(&current_image[last + y * 40]))
+		last--;
+
+	bits = pgm_read_byte(&current_image[first + y * 40]);
+	*x0 = first * 8;
+	while (!(bits & 1 << (*x0 % 8)))
+		(*x0)++;
+	bits = pgm_read_byte(&current_image[last + y * 40]);
+	*x1 = last * 8 + 7;
+	while (!(bits & 1 << (*x1 % 8)))
+		(*x1)--;
+
+	return true;
+}
+
+// Load the patch entry at patch_index.
+void LoadPatchEntry(void)
+{
+	const uint8_t *entry = &patch_data[patch_index * 3];
+	uint8_t high = pgm_read_byte(entry + 1);
+
+	patchX = pgm_read_byte(entry) | (high & 1) << 8;
+	patchY = pgm_read_byte(entry + 2);
+	patchInk = high & PATCH_INK;
+}
+
+// Load the op at plan_index.
+void LoadPlanOp(void)
+{
+	uint8_t op = pgm_read_byte(&plan_data[plan_index++]);
+
+	planOp = op >> 4;
+	planArg = op & 0x0F;
+	planSteps = planOp >= PLAN_MASK ? 4 : planOp == PLAN_INK ? 1 : planArg + 1;
+	planOpStart = true;
+}
+
+// Turn the correction lists into the row bitmap, leaving out the rows off the canvas.
+void SetupCorrection(void)
+{
+	memset(rowsToCorrect, 0, sizeof(rowsToCorrect));
+	memset(fullRowsToCorrect, 0, sizeof(fullRowsToCorrect));
+
+	for (int i = 0; i < linesToCorrectLength; i++)
+		if (linesToCorrect[i] >= 0 && linesToCorrect[i] <= 119)
+			fullRowsToCorrect[linesToCorrect[i] / 8] |= 1 << (linesToCorrect[i] % 8);
+	memcpy(rowsToCorrect, fullRowsToCorrect, sizeof(rowsToCorrect));
+	for (int i = 0; i < rectsToCorrectLength; i++)
+		for (int y = max(rectsToCorrect[i].Y0, 0); y <= min(rectsToCorrect[i].Y1, 119); y++)
+			rowsToCorrect[y / 8] |= 1 << (y % 8);
+}
+
+// Span of a row to correct, false if the row has nothing to correct.
+bool GetRowCorrectionSpan(int y, int *x0, int *x1)
+{
+	if (!inCorrectionMode || y < 0 || y > 119 || !(rowsToCorrect[y / 8] & 1 << (y % 8)))
+		return false;
+
+	// A full line wins, otherwise correct the hull of the rectangles crossing this row
+	*x0 = 0;
+	*x1 = 319;
+	if (!is_full_row_to_correct(y))
+	{
+		*x0 = 319;
+		*x1 = 0;
+		for (int i = 0; i < rectsToCorrectLength; i++)
+		{
+			if (rectsToCorrect[i].Y0 <= y && y <= rectsToCorrect[i].Y1)
+			{
+				*x0 = min(*x0, max(rectsToCorrect[i].X0, 0));
+				*x1 = max(*x1, min(rectsToCorrect[i].X1, 319));
+			}
+		}
+	}
+
+	return true;
+}
+
+// Load the span to correct on the row we just entered.
+void LoadRowCorrection(void)
+{
+	isLineThatNeedsCorrection = false;
+	correctionPhase = CORRECTION_SEEK;
+
+	if (!GetRowCorrectionSpan(ypos, &correctionX0, &correctionX1))
+		return;
+
+#ifdef SINGLE_PASS_CORRECTION
+	// The canvas only holds what we printed, so a broken row can only differ from the image
+	// around ink meant for it or for its neighbours (a skipped or extra move down shifts a
+	// whole row). Outside of that both are white and there is nothing to fix.
+	int inkX0 = 320;
+	int inkX1 = -1;
+	for (int y = ypos - 1; y <= ypos + 1; y++)
+	{
+		int x0, x1;
+		if (GetRowInkSpan(y, &x0, &x1))
+		{
+			inkX0 = min(inkX0, x0);
+			inkX1 = max(inkX1, x1);
+		}
+	}
+	correctionX0 = max(correctionX0, inkX0 - CORRECTION_MARGIN);
+	correctionX1 = min(correctionX1, inkX1 + CORRECTION_MARGIN);
+	if (correctionX0 > correctionX1)
+		return;
+#endif
+
+	isLineThatNeedsCorrection = true;
+	if (xpos - correctionX0 <= correctionX1 - xpos)
+	{
+		correctionStart = correctionX0;
+		correctionEnd = correctionX1;
+	}
+	else
+	{
+		correctionStart = correctionX1;
+		correctionEnd = correctionX0;
+	}
+
+#ifdef LARGE_BRUSH_ERASE
+	// Full lines in a band tall enough for the large brush are erased all at once when entering
+	// the band. Its rows are then only re-inked, going across from the nearest end.
+	if (is_full_row_to_correct(ypos))
+	{
+		int y0 = ypos;
+		int y1 = ypos;
+		while (y0 > 0 && is_full_row_to_correct(y0 - 1))
+			y0--;
+		while (y1 < 119 && is_full_row_to_correct(y1 + 1))
+			y1++;
+
+		if (y1 - y0 + 1 >= LARGE_BRUSH_SIZE)
+		{
+			if (ypos == y0 && bulkErasedY0 != y0)
+			{
+				bulkErasePending = true;
+				bulkY0 = y0;
+				bulkY1 = y1;
+			}
+			else
+			{
+				correctionPhase = CORRECTION_INK;
+				correctionStart = correctionEnd;
+			}
+		}
+	}
+#endif
+}
+
+// Hash of the image and of the correction settings, so a checkpoint is only resumed by the same print.
+uint16_t GetPrintTag(void)
+{
+	uint16_t crc = 0xFFFF;
+
+	for (size_t i = 0; i < sizeof(image_data); i++)
+		crc = _crc16_update(crc, pgm_read_byte(&current_image[i]));
+	for (int i = 0; i < linesToCorrectLength; i++)
+		crc = _crc16_update(crc, linesToCorrect[i]);
+	for (int i = 0; i < rectsToCorrectLength; i++)
+	{
+		crc = _crc16_update(crc, rectsToCorrect[i].X0);
+		crc = _crc16_update(crc, rectsToCorrect[i].X1);
+		crc = _crc16_update(crc, rectsToCorrect[i].Y0);
+		crc = _crc16_update(crc, rectsToCorrect[i].Y1);
+	}
+	for (uint16_t i = 0; i < plan_length; i++)
+		crc = _crc16_update(crc, pgm_read_byte(&plan_data[i]));
+
+	return crc;
+}
+
+// Look for an unfinished print to resume.
+void LoadCheckpoint(void)
+{
+	// Patches are short, they are never checkpointed, and neither are scripts
+	resuming = Checkpoint_Load(GetPrintTag(), &checkpoint) && patch_length == 0 && state != SCRIPT;
+
+	// A plan carries on with the op it was about to start, once the cursor is back there
+	if (resuming && plan_length > 0)
+	{
+		plan_index = checkpoint.PlanIndex;
+		LoadPlanOp();
+		planResumeState = MOVE;
+	}
+
+	// The reset may have cut off a later image of the queue
+	if (in_queue_mode())
+	{
+		while (!resuming && queue_index < queue_length)
+		{
+			SetQueueImage(queue_index + 1);
+			resuming = Checkpoint_Load(GetPrintTag(), &checkpoint);
+		}
+		if (!resuming)
+			SetQueueImage(0);
+	}
+}
+
+// Print the image at this place in the queue next, 0 for image.c. Its checkpoints are saved
+// with its own tag.
+void SetQueueImage(uint8_t index)
+{
+	queue_index = index;
+	current_image = index == 0 ? image_data : &queue_data[(index - 1) * sizeof(image_data)];
+	checkpoint.Tag = GetPrintTag();
+}
+
+// Remember the start of the current row as the place to resume from.
+void UpdateCheckpoint(void)
+{
+	checkpoint.XPos = xpos;
+	checkpoint.YPos = ypos;
+	checkpoint.Flags = CHECKPOINT_FLAG_VALID | (correctionPhase != CORRECTION_INK ? CHECKPOINT_FLAG_ERASING : 0);
+
+	// The EEPROM write blocks for a few ms, it only stretches the current move report a bit.
+	if (ypos % CHECKPOINT_ROWS == 0 && ypos <= 119)
+		Checkpoint_Save(&checkpoint);
+}
+
+// Remember the op about to start, and where the cursor is, as the place to resume a plan from.
+// Its steps and argument are loaded again from the op.
+void UpdatePlanCheckpoint(void)
+{
+	checkpoint.XPos = xpos;
+	checkpoint.YPos = ypos;
+	checkpoint.PlanIndex = plan_index - 1;
+	checkpoint.Flags = CHECKPOINT_FLAG_VALID;
+	planRows = 0;
+	Checkpoint_Save(&checkpoint);
+}
 
 // Prepare the next report for the host
 void GetNextReport(USB_JoystickReport_Input_t *const ReportData)
@@ -196,32 +645,75 @@ void GetNextReport(USB_JoystickReport_Input_t *const ReportData)
 	ReportData->RY = STICK_CENTER;
 	ReportData->HAT = HAT_CENTER;
 
+	// The connection dropped: sync the controller again and resume from the current row
+	if (needs_resync)
+	{
+		// The game may have missed a press whose echoes were cut off, even the last one of a plan,
+		// a patch or a script
+		uint16_t cutOff = echoes > 0 ? last_report.Button & (SWITCH_A | SWITCH_B) : 0;
+		bool planCutOff = cutOff && plan_length > 0 && patch_length == 0 && !inScriptMode;
+
+		needs_resync = false;
+		// A patch goes back to the entry of that press, the sync then carries on from there
+		if (cutOff && patch_length > 0)
+		{
+			patch_index--;
+			LoadPatchEntry();
+			if (state == DONE)
+				state = STOP;
+		}
+		if (state == DONE && inScriptMode && cutOff)
+			state = SCRIPT;
+		if (state == MOVE || state == STOP || state == BULK_ERASE || (state == DONE && planCutOff))
+		{
+			resuming = true;
+			// A plan is relative to the cursor, it goes back to where it was rather than to a row
+			if (plan_length > 0)
+			{
+				checkpoint.XPos = xpos;
+				checkpoint.YPos = ypos;
+				planResumeState = state;
+				planResumePress = planCutOff ? cutOff : 0;
+			}
+		}
+		// The press sent again once back there was cut off too
+		else if (state == RESUME_POSITION && planCutOff)
+			planResumePress = cutOff;
+		if (state == SCRIPT)
+		{
+			// A script syncs again with its own handler
+			Script_Resync(xpos, ypos, cutOff);
+			echoes = 0;
+		}
+		else if (state == QUEUE)
+		{
+			// The post is not saved yet, wait for the controller and start the sequence over
+			queueStep = -1;
+			command_count = 0;
+			echoes = 0;
+		}
+		else if (state != DONE || resuming)
+		{
+			state = SYNC_CONTROLLER;
+			command_count = 0;
+			echoes = 0;
+		}
+	}
+
 	// Repeat ECHOES times the last report
 	if (echoes > 0)
 	{
 		memcpy(ReportData, &last_report, sizeof(USB_JoystickReport_Input_t));
 		echoes--;
+		Counters_Echo();
 		return;
 	}
 
-	// Check if this line needs correction when in correction mode
-	bool isLineThatNeedsCorrection = false;
-	if (inCorrectionMode) 
-	{
-		for (size_t i = 0; i < linesToCorrectLength; i++)
-		{
-			if (linesToCorrect[i] == ypos) {
-				isLineThatNeedsCorrection = true;
-				break;
-			}
-		}
-	}
-
 	// States and moves management
 	switch (state)
 	{
 	case SYNC_CONTROLLER:
-		if (command_count > ms_2_count(2000))
+		if (command_count > ms_2_count(SYNC_CONTROLLER_MS))
 		{
 			command_count = 0;
 			state = SYNC_POSITION;
@@ -230,48 +722,236 @@ void GetNextReport(USB_JoystickReport_Input_t *const ReportData)
 			command_count++;
 		break;
 	case SYNC_POSITION:
-		if (command_count > ms_2_count(4000))
+		if (command_count > ms_2_count(SYNC_POSITION_MS))
 		{
 			command_count = 0;
 			xpos = 0;
 			ypos = 0;
-			state = STOP;
+			if (patch_length > 0)
+			{
+				// After a resync just carry on from the current entry
+				resuming = false;
+				LoadPatchEntry();
+				state = MOVE;
+			}
+			else if (resuming)
+				state = RESUME_POSITION;
+			else if (plan_length > 0)
+			{
+				LoadPlanOp();
+				state = MOVE;
+			}
+			else
+			{
+				LoadRowCorrection();
+				UpdateCheckpoint();
+				state = STOP;
+			}
 		}
 		else
 		{
 			// Moving faster with LX/LY
 			ReportData->LX = STICK_MIN;
 			ReportData->LY = STICK_MIN;
-			// Clear the screen
-			if (!inCorrectionMode && command_count == ms_2_count(1500)) 
+			// Clear the screen (not when resuming or patching, we would lose what was printed)
+			if ((plan_length > 0 || !inCorrectionMode) && !resuming && patch_length == 0 && command_count == ms_2_count(SYNC_POSITION_MS * 3 / 8))
 				ReportData->Button |= SWITCH_LCLICK;
 			// Select brush
-			if (command_count == ms_2_count(3000))
+			if (command_count == ms_2_count(SYNC_POSITION_MS * 3 / 4))
+				ReportData->Button |= SWITCH_L;
+#ifdef LARGE_BRUSH_ERASE
+			// We may have been cut off with the large brush selected, step all the way down
+			if (command_count > ms_2_count(SYNC_POSITION_MS * 3 / 4)
+				&& command_count <= ms_2_count(SYNC_POSITION_MS * 3 / 4) + LARGE_BRUSH_STEPS * 2
+				&& (command_count - ms_2_count(SYNC_POSITION_MS * 3 / 4)) % 2 == 0)
 				ReportData->Button |= SWITCH_L;
+#endif
 
 			command_count++;
 		}
 		break;
+	case RESUME_POSITION:
+		// Walk the cursor back to the checkpoint without inking, one pixel every other report
+		if (xpos == checkpoint.XPos && ypos == checkpoint.YPos && planResumePress)
+		{
+			ReportData->Button |= planResumePress;
+			planResumePress = 0;
+		}
+		else if (xpos == checkpoint.XPos && ypos == checkpoint.YPos)
+		{
+			resuming = false;
+			if (plan_length > 0)
+				state = planResumeState;
+			else
+			{
+				LoadRowCorrection();
+				if (!(checkpoint.Flags & CHECKPOINT_FLAG_ERASING))
+					correctionPhase = CORRECTION_INK;
+				state = STOP;
+			}
+		}
+		else if (command_count++ % 2 == 0)
+		{
+			if (ypos < checkpoint.YPos)
+				ReportData->HAT = HAT_BOTTOM;
+			else if (xpos < checkpoint.XPos)
+				ReportData->HAT = HAT_RIGHT;
+			else
+				ReportData->HAT = HAT_LEFT;
+		}
+		break;
+	case BULK_ERASE:
+#ifdef LARGE_BRUSH_ERASE
+		switch (bulkStep)
+		{
+		case BULK_BRUSH_UP:
+			// Step up to the large brush, pressing R every other report
+			if (command_count < LARGE_BRUSH_STEPS * 2)
+			{
+				if (command_count % 2 == 0)
+					ReportData->Button |= SWITCH_R;
+				command_count++;
+			}
+			else
+			{
+				command_count = 0;
+				bulkStrokeY = bulkY0 + LARGE_BRUSH_SIZE / 2;
+				bulkStep = BULK_HOME;
+			}
+			break;
+		case BULK_HOME:
+			// Push the cursor against the nearest side, so strokes cover the whole width
+			if (command_count < ms_2_count(LARGE_BRUSH_STROKE_MS))
+			{
+				ReportData->LX = xpos < 160 ? STICK_MIN : STICK_MAX;
+				command_count++;
+			}
+			else
+			{
+				xpos = xpos < 160 ? 0 : 319;
+				command_count = 0;
+				bulkStep = BULK_SEEK;
+			}
+			break;
+		case BULK_SEEK:
+			// Move down to the middle row of the next stroke
+			if (ypos != bulkStrokeY)
+			{
+				if (command_count++ % 2 == 0)
+					ReportData->HAT = HAT_BOTTOM;
+			}
+			else
+			{
+				command_count = 0;
+				bulkStep = BULK_STROKE;
+			}
+			break;
+		case BULK_STROKE:
+			// Hold B and cross the canvas to the other side
+			if (command_count < ms_2_count(LARGE_BRUSH_STROKE_MS))
+			{
+				ReportData->Button |= SWITCH_B;
+				ReportData->LX = xpos == 0 ? STICK_MAX : STICK_MIN;
+				command_count++;
+			}
+			else
+			{
+				xpos = xpos == 0 ? 319 : 0;
+				command_count = 0;
+				// Strokes are LARGE_BRUSH_SIZE rows apart, the last one is flush with the end of the band
+				if (bulkStrokeY + LARGE_BRUSH_SIZE / 2 >= bulkY1)
+					bulkStep = BULK_BRUSH_DOWN;
+				else
+				{
+					bulkStrokeY = min(bulkStrokeY + LARGE_BRUSH_SIZE, bulkY1 - LARGE_BRUSH_SIZE / 2);
+					bulkStep = BULK_SEEK;
+				}
+			}
+			break;
+		case BULK_BRUSH_DOWN:
+			// Back to the pixel brush
+			if (command_count < LARGE_BRUSH_STEPS * 2)
+			{
+				if (command_count % 2 == 0)
+					ReportData->Button |= SWITCH_L;
+				command_count++;
+			}
+			else
+			{
+				command_count = 0;
+				bulkStep = BULK_RETURN;
+			}
+			break;
+		case BULK_RETURN:
+			// Back up to the first row of the band to re-ink it
+			if (ypos != bulkY0)
+			{
+				if (command_count++ % 2 == 0)
+					ReportData->HAT = HAT_TOP;
+			}
+			else
+			{
+				bulkErasedY0 = bulkY0;
+				LoadRowCorrection();
+				state = STOP;
+			}
+			break;
+		}
+#endif
+		break;
 	case MOVE:
-		// In correction mode we always do one pass from left to right to erase the line.
-		// Then a second pass from right to left to re-ink.
-		if (inCorrectionMode)
+		// In patch mode we go straight to the next pixel, horizontally first.
+		if (patch_length > 0)
+		{
+			if (xpos != patchX)
+				ReportData->HAT = hat_towards(patchX);
+			else if (ypos < patchY)
+				ReportData->HAT = HAT_BOTTOM;
+			else if (ypos > patchY)
+				ReportData->HAT = HAT_TOP;
+		}
+		// A plan says where to go next. The checkpoint is taken before the op, once every press
+		// of the previous one went through.
+		else if (plan_length > 0)
+		{
+			if (planOpStart && planRows >= CHECKPOINT_ROWS)
+				UpdatePlanCheckpoint();
+			planOpStart = false;
+			if (planOp != PLAN_INK)
+				ReportData->HAT = planHatTable[(planOp >= PLAN_MASK ? planOp - PLAN_MASK : planOp) & 3];
+		}
+		// In correction mode we move to the nearest end of the span to correct, then do one pass
+		// across it to erase, then a second pass back to re-ink.
+		else if (inCorrectionMode)
 		{
 			if (isLineThatNeedsCorrection)
 			{
-				if (isCorrectionModeErasing && xpos < 319)
-					ReportData->HAT = HAT_RIGHT;
-				else if (isCorrectionModeErasing) 
+#ifdef SINGLE_PASS_CORRECTION
+				// A single pass across the span, the next row starts from its own nearest end
+				if (correctionPhase == CORRECTION_SEEK)
+					ReportData->HAT = hat_towards(correctionStart);
+				else if (xpos != correctionEnd)
+					ReportData->HAT = hat_towards(correctionEnd);
+				else
+					ReportData->HAT = HAT_BOTTOM;
+#else
+				if (correctionPhase == CORRECTION_SEEK && xpos == correctionStart)
+					correctionPhase = CORRECTION_ERASE;
+
+				if (correctionPhase == CORRECTION_SEEK)
+					ReportData->HAT = hat_towards(correctionStart);
+				else if (correctionPhase == CORRECTION_ERASE && xpos != correctionEnd)
+					ReportData->HAT = hat_towards(correctionEnd);
+				else if (correctionPhase == CORRECTION_ERASE)
 				{
-					isCorrectionModeErasing = false;
+					correctionPhase = CORRECTION_INK;
 					ReportData->HAT = HAT_CENTER; // This makes us stop here twice so we can ink the erased pixel again if needed
 				}
-				else if (!isCorrectionModeErasing && xpos > 0) 
-					ReportData->HAT = HAT_LEFT;
-				else {
-					isCorrectionModeErasing = true; // Reset for next line that needs fixing
+				else if (xpos != correctionStart)
+					ReportData->HAT = hat_towards(correctionStart);
+				else
 					ReportData->HAT = HAT_BOTTOM;
-				}
+#endif
 			}
 			else 
 				ReportData->HAT = HAT_BOTTOM;
@@ -289,13 +969,69 @@ void GetNextReport(USB_JoystickReport_Input_t *const ReportData)
 		state = STOP;
 		break;
 	case STOP:
+#ifdef LARGE_BRUSH_ERASE
+		if (bulkErasePending)
+		{
+			bulkErasePending = false;
+			bulkStep = BULK_BRUSH_UP;
+			command_count = 0;
+			state = BULK_ERASE;
+			break;
+		}
+#endif
+		if (patch_length > 0)
+		{
+			state = MOVE;
+			if (xpos == patchX && ypos == patchY)
+			{
+				ReportData->Button |= patchInk ? SWITCH_A : SWITCH_B;
+				if (++patch_index == patch_length)
+					state = DONE;
+				else
+					LoadPatchEntry();
+			}
+			break;
+		}
+
+		if (plan_length > 0)
+		{
+			state = MOVE;
+			if (planOp == PLAN_INK || (planOp >= PLAN_MOVE_INK && planOp < PLAN_INK) || (planOp >= PLAN_MASK && planArg & 1))
+				ReportData->Button |= SWITCH_A;
+			if (planOp >= PLAN_MASK)
+				planArg >>= 1;
+			if (--planSteps == 0)
+			{
+				if (plan_index == plan_length)
+				{
+					Checkpoint_Clear(&checkpoint);
+					state = DONE;
+				}
+				else
+					LoadPlanOp();
+			}
+			break;
+		}
+
 		// Inking (the printing patterns above will not move outside the canvas... is not necessary to test them)
-		if (isLineThatNeedsCorrection) 
+		// In correction mode only the span is touched, the cursor may cross other pixels on its way there
+		if (isLineThatNeedsCorrection && xpos >= correctionX0 && xpos <= correctionX1)
 		{
-			if (isCorrectionModeErasing)
+#ifdef SINGLE_PASS_CORRECTION
+			if (correctionPhase == CORRECTION_SEEK && xpos == correctionStart)
+				correctionPhase = CORRECTION_SET;
+#endif
+			if (correctionPhase == CORRECTION_SET)
+				ReportData->Button |= is_black(xpos, ypos) ? SWITCH_A : SWITCH_B;
+			else if (correctionPhase == CORRECTION_INK)
+			{
+				if (is_black(xpos, ypos))
+					ReportData->Button |= SWITCH_A;
+			}
+#ifndef SINGLE_PASS_CORRECTION
+			else
 				ReportData->Button |= SWITCH_B;
-			else if (is_black(xpos, ypos)) 
-				ReportData->Button |= SWITCH_A;
+#endif
 		}
 		else if(!inCorrectionMode) {
 			// In printing mode we only ink, no erasing
@@ -305,10 +1041,53 @@ void GetNextReport(USB_JoystickReport_Input_t *const ReportData)
 
 		state = MOVE;
 		if (ypos > 119)
-			state = DONE;
+		{
+			Checkpoint_Clear(&checkpoint);
+			state = in_queue_mode() && queue_index < queue_length ? QUEUE : DONE;
+			command_count = 0;
+			queueStep = -1;
+		}
 		break;
 	case DONE:
 		return;
+	case SCRIPT:
+		if (!Script_Next(ReportData, &xpos, &ypos))
+			state = DONE;
+		break;
+	case QUEUE:
+		if (queueStep < 0)
+		{
+			// Wait for the next post, at least as long as the Switch takes to pick up the controller
+			if (command_count > ms_2_count(SYNC_CONTROLLER_MS) && queue_triggered())
+			{
+				command_count = 0;
+				queueStep = 0;
+			}
+			else
+				command_count++;
+		}
+		else if (queueStep < queueSaveSequenceLength)
+		{
+			// Hold each report of the save sequence, the next one starts with a release
+			if (command_count < ms_2_count(queueSaveSequence[queueStep].Ms))
+			{
+				ReportData->Button = queueSaveSequence[queueStep].Button;
+				command_count++;
+			}
+			else
+			{
+				command_count = 0;
+				queueStep++;
+			}
+		}
+		else
+		{
+			// On a new canvas, which the sync clears again, with the controller still paired
+			SetQueueImage(queue_index + 1);
+			command_count = 0;
+			state = SYNC_POSITION;
+		}
+		break;
 	}
 
 	if (state != SYNC_CONTROLLER && state != SYNC_POSITION && state != DONE)
@@ -322,9 +1101,24 @@ void GetNextReport(USB_JoystickReport_Input_t *const ReportData)
 			ypos--;
 		else if (ReportData->HAT == HAT_BOTTOM)
 			ypos++;
+		if (plan_length > 0 && !resuming && (ReportData->HAT == HAT_TOP || ReportData->HAT == HAT_BOTTOM) && planRows < 255)
+			planRows++;
+
+		// Entering a new row (the bulk erase only goes through the band it erases, scripts
+		// correct rows with their own ops)
+		if (ReportData->HAT == HAT_BOTTOM && state != BULK_ERASE && state != SCRIPT)
+		{
+			LoadRowCorrection();
+			if (!resuming && patch_length == 0 && plan_length == 0)
+				UpdateCheckpoint();
+		}
 	}
 
+	Counters_Position(xpos, ypos, state);
+	Timing_State(state);
+	Telemetry_Position(ypos, state);
+
 	// Prepare to echo this report
 	memcpy(&last_report, ReportData, sizeof(USB_JoystickReport_Input_t));
-	echoes = ECHOES;
+	echoes = ReportData->HAT != HAT_CENTER ? MOVE_ECHOES : STOP_ECHOES;
 }
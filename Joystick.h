@@ -43,6 +43,7 @@
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 #include <string.h>
+#include <util/crc16.h>
 
 #include <LUFA/Drivers/USB/USB.h>
 #include <LUFA/Drivers/Board/Joystick.h>
@@ -51,6 +52,9 @@
 #include <LUFA/Platform/Platform.h>
 
 #include "Descriptors.h"
+#include "Checkpoint.h"
+#include "Counters.h"
+#include "Telemetry.h"
 
 // Type Defines
 // Enumeration for joystick buttons.
@@ -107,6 +111,43 @@ typedef struct {
 	uint8_t  RY;     // Right Stick Y
 } USB_JoystickReport_Output_t;
 
+// Rectangle of the canvas to erase and re-ink in correction mode, bounds included.
+typedef struct {
+	int X0;
+	int X1;
+	int Y0;
+	int Y1;
+} CorrectionRect_t;
+
+// Report of the sequence that saves a post in queue mode: the buttons are held for Ms, then released.
+typedef struct {
+	uint16_t Button;
+	uint16_t Ms;
+} QueueStep_t;
+
+// States of GetNextReport.
+typedef enum {
+	SYNC_CONTROLLER,
+	SYNC_POSITION,
+	RESUME_POSITION,
+	BULK_ERASE,
+	MOVE,
+	STOP,
+	DONE,
+	SCRIPT,
+	QUEUE
+} State_t;
+
+// Plan ops are one byte, the op in the high nibble and n in the low one.
+#define PLAN_MOVE     0x0 // 0x0-0x3: move n+1 pixels towards planHatTable[op], without inking
+#define PLAN_MOVE_INK 0x4 // 0x4-0x7: move n+1 pixels towards planHatTable[op - 4], inking each
+#define PLAN_INK      0x8 // Ink the pixel under the cursor
+#define PLAN_MASK     0x9 // 0x9-0xC: move 4 pixels towards planHatTable[op - 9], inking where n has a bit set (bit 0 first)
+extern const uint8_t planHatTable[4];
+
+// The script interpreter fills reports too
+#include "ScriptVM.h"
+
 // Function Prototypes
 // Setup all necessary hardware, including USB initialization.
 void SetupHardware(void);
@@ -117,6 +158,16 @@ void EVENT_USB_Device_Connect(void);
 void EVENT_USB_Device_Disconnect(void);
 void EVENT_USB_Device_ConfigurationChanged(void);
 void EVENT_USB_Device_ControlRequest(void);
+// Build the row bitmap from the correction lists.
+void SetupCorrection(void);
+// Look for an unfinished print to resume.
+void LoadCheckpoint(void);
+// Print the image at this place in the queue next, 0 for image.c.
+void SetQueueImage(uint8_t index);
+// Leftmost and rightmost black pixels of a row, false if the row is blank.
+bool GetRowInkSpan(int y, int *x0, int *x1);
+// Span of a row to correct, false if the row has nothing to correct.
+bool GetRowCorrectionSpan(int y, int *x0, int *x1);
 // Prepare the next report for the host.
 void GetNextReport(USB_JoystickReport_Input_t* const ReportData);
 
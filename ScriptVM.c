@@ -0,0 +1,351 @@
+/** \file
+ *
+ *  Script interpreter: sends the reports a script in script.c asks for, so new print routes,
+ *  sync sequences or game profiles are data instead of firmware code. Build with -DSCRIPT_VM.
+ *
+ *  Moves are sent as in the rest of the firmware, one report pressing the D-pad then one stop
+ *  report, which inks or erases the pixel the cursor arrived on. Ops that move the cursor run
+ *  in stages of such moves (see Script_LoadStage).
+ */
+
+#include "Joystick.h"
+
+#ifdef SCRIPT_VM
+
+extern const uint8_t image_data[0x12c1] PROGMEM;
+extern const uint16_t plan_length;
+extern const uint8_t plan_data[] PROGMEM;
+extern const uint16_t script_length;
+extern const uint8_t script_data[] PROGMEM;
+
+// Between two ops
+#define SCRIPT_IDLE 0xFF
+
+#define is_inked(x, y) ((x) >= 0 && (x) < 320 && (y) >= 0 && (y) < 120 \
+	&& pgm_read_byte(&(image_data[((x) / 8) + ((y) * 40)])) & 1 << ((x) % 8))
+
+// What a stop does to the pixel under the cursor.
+typedef enum {
+	SCRIPT_ACTION_NONE,
+	SCRIPT_ACTION_INK,       // A
+	SCRIPT_ACTION_INK_BLACK, // A on black pixels
+	SCRIPT_ACTION_ERASE,     // B
+	SCRIPT_ACTION_SET,       // A on black pixels, B on white ones
+	SCRIPT_ACTION_MASK       // A where the low bit of Mask is set, one bit per stop
+} ScriptAction_t;
+
+typedef struct {
+	uint16_t Start;   // First op of the loop
+	uint16_t Count;   // Runs left
+} ScriptLoop_t;
+
+// Where the script is, saved while the resync handler runs.
+typedef struct {
+	uint16_t PC;      // Next op
+	uint16_t Operands;// Of the op being run
+	uint8_t  Op;      // Op being run, SCRIPT_IDLE between ops
+	uint8_t  Stage;   // Next stage of the op
+	uint16_t Count;   // Reports or moves left in the stage
+	uint8_t  Direction;
+	uint8_t  Action;  // ScriptAction_t
+	uint8_t  Mask;
+	bool     Stop;    // The next report is a stop
+	int      Start;   // Span of a SCRIPT_SPAN or SCRIPT_FIX, Start is the end nearest to the cursor
+	int      End;
+	uint16_t PlanIndex;
+	uint8_t  Depth;
+	ScriptLoop_t Loops[SCRIPT_LOOP_DEPTH];
+} ScriptContext_t;
+
+// Bytes taken by each op and its operands
+static const uint8_t scriptOpSizes[] = {1, 8, 4, 3, 1, 3, 4, 4, 1, 1, 2, 1, 1};
+
+static ScriptContext_t context;
+static ScriptContext_t interrupted;
+static bool inHandler = false;
+static int resumeX = 0;
+static int resumeY = 0;
+static uint16_t resumePress = 0;
+
+bool Script_Init(void)
+{
+	context.PC = 2;
+	context.Op = SCRIPT_IDLE;
+	context.Depth = 0;
+	inHandler = false;
+
+	return script_length > 0;
+}
+
+void Script_Resync(const int XPos, const int YPos, const uint16_t Press)
+{
+	uint16_t handler = pgm_read_word(&script_data[0]);
+
+	if (handler == SCRIPT_NO_HANDLER)
+		return;
+
+	// Dropped again while syncing: the handler starts over, still going back to the first drop
+	if (!inHandler)
+	{
+		interrupted = context;
+		resumeX = XPos;
+		resumeY = YPos;
+		resumePress = Press;
+		inHandler = true;
+	}
+	context.PC = handler;
+	context.Op = SCRIPT_IDLE;
+	context.Depth = 0;
+}
+
+static void Script_Walk(const uint8_t Direction, const uint16_t Count, const uint8_t Action, const bool StopFirst)
+{
+	context.Direction = Direction;
+	context.Count = Count;
+	context.Action = Action;
+	context.Stop = StopFirst;
+}
+
+// Along the row from X to Target.
+static void Script_WalkTo(const int X, const int Target, const uint8_t Action, const bool StopFirst)
+{
+	Script_Walk(Target >= X ? 0 : 1, Target >= X ? Target - X : X - Target, Action, StopFirst);
+}
+
+// Make Start the end of the span nearest to X.
+static void Script_OrderSpan(const int X)
+{
+	if (X - context.Start > context.End - X)
+	{
+		int start = context.Start;
+		context.Start = context.End;
+		context.End = start;
+	}
+}
+
+// Set up the next stage of moves of the op being run, returns false once the op is done.
+static bool Script_LoadStage(const int XPos, const int YPos)
+{
+	const uint8_t* operands = &script_data[context.Operands];
+	uint8_t stage = context.Stage++;
+	uint8_t op;
+
+	switch (context.Op)
+	{
+	case SCRIPT_MOVE:
+	case SCRIPT_STEP:
+		if (stage > 0)
+			return false;
+		Script_Walk(pgm_read_byte(operands), pgm_read_word(operands + 1),
+			context.Op == SCRIPT_STEP ? SCRIPT_ACTION_INK_BLACK : SCRIPT_ACTION_NONE, false);
+		return true;
+	case SCRIPT_INK:
+		if (stage > 0)
+			return false;
+		Script_Walk(0, 0, SCRIPT_ACTION_INK_BLACK, true);
+		return true;
+	case SCRIPT_SPAN:
+		// Seek the nearest end, then cross to the other one
+		if (stage == 0)
+		{
+			if (!GetRowInkSpan(YPos, &context.Start, &context.End))
+				return false;
+			Script_OrderSpan(XPos);
+			Script_WalkTo(XPos, context.Start, SCRIPT_ACTION_NONE, false);
+		}
+		else if (stage == 1)
+			Script_WalkTo(XPos, context.End, SCRIPT_ACTION_INK_BLACK, true);
+		else
+			return false;
+		return true;
+	case SCRIPT_FIX:
+		// Seek the nearest end, erase across the span (or set each pixel), re-ink coming back
+		if (stage == 0)
+		{
+			if (!GetRowCorrectionSpan(YPos, &context.Start, &context.End))
+				return false;
+			Script_OrderSpan(XPos);
+			Script_WalkTo(XPos, context.Start, SCRIPT_ACTION_NONE, false);
+		}
+		else if (stage == 1)
+			Script_WalkTo(XPos, context.End, pgm_read_byte(operands) == SCRIPT_FIX_ONE_PASS
+				? SCRIPT_ACTION_SET : SCRIPT_ACTION_ERASE, true);
+		else if (stage == 2 && pgm_read_byte(operands) != SCRIPT_FIX_ONE_PASS)
+			Script_WalkTo(XPos, context.Start, SCRIPT_ACTION_INK_BLACK, true);
+		else
+			return false;
+		return true;
+	case SCRIPT_PLAN:
+		// One stage per op of the plan
+		if (context.PlanIndex == plan_length)
+			return false;
+		op = pgm_read_byte(&plan_data[context.PlanIndex++]);
+		context.Mask = op & 0x0F;
+		op >>= 4;
+		if (op == PLAN_INK)
+			Script_Walk(0, 0, SCRIPT_ACTION_INK, true);
+		else if (op >= PLAN_MASK)
+			Script_Walk(op - PLAN_MASK, 4, SCRIPT_ACTION_MASK, false);
+		else
+			Script_Walk(op & 3, context.Mask + 1, op >= PLAN_MOVE_INK ? SCRIPT_ACTION_INK : SCRIPT_ACTION_NONE, false);
+		return true;
+	case SCRIPT_RESUME:
+		// Vertically first, the cursor comes back from the top left corner
+		if (stage == 0)
+			Script_Walk(resumeY >= YPos ? 2 : 3, resumeY >= YPos ? resumeY - YPos : YPos - resumeY, SCRIPT_ACTION_NONE, false);
+		else if (stage == 1)
+			Script_WalkTo(XPos, resumeX, SCRIPT_ACTION_NONE, false);
+		else
+			return false;
+		return true;
+	}
+
+	return false;
+}
+
+// Press what the action of the stage asks for on the pixel under the cursor.
+static void Script_Act(USB_JoystickReport_Input_t* const ReportData, const int XPos, const int YPos)
+{
+	switch (context.Action)
+	{
+	case SCRIPT_ACTION_INK:
+		ReportData->Button |= SWITCH_A;
+		break;
+	case SCRIPT_ACTION_INK_BLACK:
+		if (is_inked(XPos, YPos))
+			ReportData->Button |= SWITCH_A;
+		break;
+	case SCRIPT_ACTION_ERASE:
+		ReportData->Button |= SWITCH_B;
+		break;
+	case SCRIPT_ACTION_SET:
+		ReportData->Button |= is_inked(XPos, YPos) ? SWITCH_A : SWITCH_B;
+		break;
+	case SCRIPT_ACTION_MASK:
+		if (context.Mask & 1)
+			ReportData->Button |= SWITCH_A;
+		context.Mask >>= 1;
+		break;
+	}
+}
+
+// Run the op at PC, returns false on SCRIPT_END.
+static bool Script_Fetch(int* const XPos, int* const YPos)
+{
+	uint8_t op = context.PC < script_length ? pgm_read_byte(&script_data[context.PC]) : SCRIPT_END;
+	const uint8_t* operands = &script_data[context.PC + 1];
+
+	// Unknown ops end the script, as if it had been cut short
+	if (op == SCRIPT_END || op >= sizeof(scriptOpSizes))
+		return false;
+	context.Operands = context.PC + 1;
+	context.PC += scriptOpSizes[op];
+
+	switch (op)
+	{
+	case SCRIPT_REPORT:
+		context.Op = op;
+		context.Count = pgm_read_word(operands + 5);
+		break;
+	case SCRIPT_SETXY:
+		*XPos = pgm_read_word(operands);
+		*YPos = pgm_read_byte(operands + 2);
+		break;
+	case SCRIPT_LOOP:
+		// Nested deeper than the frames kept, the matching next would repeat the wrong loop:
+		// the script ends instead, as if it had been cut short
+		if (context.Depth == SCRIPT_LOOP_DEPTH)
+			return false;
+		context.Loops[context.Depth].Start = context.PC;
+		context.Loops[context.Depth].Count = pgm_read_word(operands);
+		context.Depth++;
+		break;
+	case SCRIPT_NEXT:
+		if (context.Depth > 0 && --context.Loops[context.Depth - 1].Count > 0)
+			context.PC = context.Loops[context.Depth - 1].Start;
+		else if (context.Depth > 0)
+			context.Depth--;
+		break;
+	case SCRIPT_JUMP:
+		context.PC = pgm_read_word(operands);
+		break;
+	case SCRIPT_RESUME:
+		// Only means something at the end of the resync handler
+		if (!inHandler)
+			break;
+		// Fall through
+	default:
+		context.Op = op;
+		context.Stage = 0;
+		context.Count = 0;
+		context.Stop = false;
+		context.PlanIndex = 0;
+		break;
+	}
+
+	return true;
+}
+
+bool Script_Next(USB_JoystickReport_Input_t* const ReportData, int* const XPos, int* const YPos)
+{
+	for (uint8_t i = 0; i < SCRIPT_MAX_OPS; i++)
+	{
+		if (context.Op == SCRIPT_REPORT)
+		{
+			if (context.Count > 0)
+			{
+				const uint8_t* operands = &script_data[context.Operands];
+
+				context.Count--;
+				ReportData->Button = pgm_read_word(operands);
+				ReportData->HAT = pgm_read_byte(operands + 2);
+				ReportData->LX = pgm_read_byte(operands + 3);
+				ReportData->LY = pgm_read_byte(operands + 4);
+				return true;
+			}
+			context.Op = SCRIPT_IDLE;
+		}
+		else if (context.Op != SCRIPT_IDLE)
+		{
+			if (context.Stop)
+			{
+				context.Stop = false;
+				Script_Act(ReportData, *XPos, *YPos);
+				return true;
+			}
+			if (context.Count > 0)
+			{
+				context.Count--;
+				context.Stop = true;
+				ReportData->HAT = planHatTable[context.Direction & 3];
+				return true;
+			}
+			if (Script_LoadStage(*XPos, *YPos))
+				continue;
+
+			// Back where the connection dropped, carry on with what was interrupted, the op that
+			// was interrupted having already moved on from a press the drop may have cut off
+			if (context.Op == SCRIPT_RESUME)
+			{
+				context = interrupted;
+				inHandler = false;
+				if (resumePress)
+				{
+					ReportData->Button |= resumePress;
+					resumePress = 0;
+					return true;
+				}
+				continue;
+			}
+			context.Op = SCRIPT_IDLE;
+		}
+
+		if (!Script_Fetch(XPos, YPos))
+			return false;
+	}
+
+	// Nothing to send after SCRIPT_MAX_OPS ops, a neutral report keeps the host fed
+	return true;
+}
+
+#endif
@@ -0,0 +1,65 @@
+/** \file
+ *
+ *  Header file for ScriptVM.c.
+ *
+ *  A script is a stream of ops, each one byte followed by its operands (little endian), after a
+ *  2 byte header with the address of the resync handler (SCRIPT_NO_HANDLER if there is none).
+ *  Addresses count from the start of script_data. script2c.py assembles scripts.
+ */
+
+#ifndef _SCRIPTVM_H_
+#define _SCRIPTVM_H_
+
+// Includes
+#include <avr/pgmspace.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Macros
+// Nested loops a script may have, a script that nests deeper ends at the loop that overflows.
+#ifndef SCRIPT_LOOP_DEPTH
+#define SCRIPT_LOOP_DEPTH 4
+#endif
+// Ops run for one report at most, a script that loops without sending anything still lets
+// the report go out.
+#ifndef SCRIPT_MAX_OPS
+#define SCRIPT_MAX_OPS 32
+#endif
+
+#define SCRIPT_NO_HANDLER 0xFFFF
+
+// Ops. Directions are 0 right, 1 left, 2 down, 3 up (as in planHatTable, Joystick.c).
+#define SCRIPT_END    0x00 // The print is done
+#define SCRIPT_REPORT 0x01 // Buttons (2 bytes), HAT, LX, LY, n (2): send this report n times
+#define SCRIPT_SETXY  0x02 // X (2 bytes), Y: the cursor is there, after pushing it into a corner
+#define SCRIPT_LOOP   0x03 // n (2 bytes): run the ops up to the matching SCRIPT_NEXT n times
+#define SCRIPT_NEXT   0x04
+#define SCRIPT_JUMP   0x05 // Address (2 bytes)
+#define SCRIPT_MOVE   0x06 // Direction, n (2 bytes): move n pixels without inking
+#define SCRIPT_STEP   0x07 // Direction, n (2 bytes): move n pixels, inking the black ones
+#define SCRIPT_INK    0x08 // Ink the pixel under the cursor if it is black
+#define SCRIPT_SPAN   0x09 // Go to the nearest end of the black pixels of the row, and cross them inking
+#define SCRIPT_FIX    0x0A // Mode: correct the span of the row (see GetRowCorrectionSpan), SCRIPT_FIX_*
+#define SCRIPT_PLAN   0x0B // Play back plan.c
+#define SCRIPT_RESUME 0x0C // Walk back to where the connection dropped and carry on from there
+
+#define SCRIPT_FIX_TWO_PASS 0x00 // Erase across the span, re-ink coming back
+#define SCRIPT_FIX_ONE_PASS 0x01 // Press A on black pixels and B on white ones in one pass
+
+// Function Prototypes
+#ifdef SCRIPT_VM
+// Start the script, returns false if script.c is empty.
+bool Script_Init(void);
+// Fill the next report, the cursor being at XPos, YPos (which SCRIPT_SETXY may change).
+// Returns false once the script has ended.
+bool Script_Next(USB_JoystickReport_Input_t* const ReportData, int* const XPos, int* const YPos);
+// The connection dropped with the cursor at XPos, YPos: run the resync handler. Press is the A or
+// B the drop may have cut off, sent again once resumed.
+void Script_Resync(const int XPos, const int YPos, const uint16_t Press);
+#else
+#define Script_Init() false
+#define Script_Next(ReportData, XPos, YPos) false
+#define Script_Resync(XPos, YPos, Press)
+#endif
+
+#endif
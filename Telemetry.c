@@ -0,0 +1,175 @@
+/** \file
+ *
+ *  Telemetry over the USART, to follow a print live from a PC: progress, row timings, lag and
+ *  USB drops. On an Arduino UNO the 16u2 sends to pin 0 (hold the 328p in reset
+ *  by wiring RESET to GND). Sending is interrupt driven from a small ring, so HID_Task never
+ *  waits on the line.
+ */
+
+#include "Joystick.h"
+
+#ifdef UART_TELEMETRY
+
+#include <util/crc16.h>
+
+#define TELEMETRY_PAYLOAD_MAX 8
+#define TELEMETRY_FRAME_MAX   (3 + 4 + TELEMETRY_PAYLOAD_MAX + 1)
+
+static volatile uint8_t buffer[TELEMETRY_BUFFER_SIZE];
+static volatile uint8_t head = 0; // Next byte to queue
+static volatile uint8_t tail = 0; // Next byte to send
+static uint16_t dropped = 0;
+
+static uint32_t clock_ms = 0;
+static uint32_t clock_ticks = 0;
+static uint32_t last_poll = 0;
+static bool polled = false;
+static uint8_t last_y = 0;
+static uint8_t last_state = 0xFF;
+static uint32_t row_start = 0;
+static uint16_t row_reports = 0;
+
+ISR(USART1_UDRE_vect)
+{
+	if (head == tail)
+		UCSR1B &= ~(1 << UDRIE1);
+	else
+	{
+		UDR1 = buffer[tail];
+		tail = (tail + 1) % TELEMETRY_BUFFER_SIZE;
+	}
+}
+
+// Milliseconds since power up, kept from Timer1 so it doesn't wrap with the ticks
+static uint32_t Telemetry_Ms(void)
+{
+	uint8_t sreg = SREG;
+	uint32_t elapsed;
+	uint32_t ms;
+
+	cli();
+	elapsed = Counters_Ticks() - clock_ticks;
+	clock_ms += elapsed / COUNTERS_TICKS_PER_MS;
+	clock_ticks += elapsed / COUNTERS_TICKS_PER_MS * COUNTERS_TICKS_PER_MS;
+	ms = clock_ms;
+	SREG = sreg;
+
+	return ms;
+}
+
+// Build a frame, returns its size
+static uint8_t Telemetry_Frame(uint8_t* const Frame, const uint8_t Type, const void* const Payload, const uint8_t Length)
+{
+	uint32_t now = Telemetry_Ms();
+	uint8_t size = 0;
+	uint8_t crc = 0;
+
+	Frame[size++] = TELEMETRY_SYNC;
+	Frame[size++] = Type;
+	Frame[size++] = Length;
+	for (uint8_t i = 0; i < 4; i++)
+		Frame[size++] = now >> (8 * i);
+	for (uint8_t i = 0; i < Length; i++)
+		Frame[size++] = ((const uint8_t*)Payload)[i];
+	for (uint8_t i = 1; i < size; i++)
+		crc = _crc8_ccitt_update(crc, Frame[i]);
+	Frame[size++] = crc;
+
+	return size;
+}
+
+// Queue a frame if there's room for it, interrupts must be off
+static bool Telemetry_Queue(const uint8_t* const Frame, const uint8_t Size)
+{
+	uint8_t room = (tail + TELEMETRY_BUFFER_SIZE - head - 1) % TELEMETRY_BUFFER_SIZE;
+
+	if (Size > room)
+		return false;
+	for (uint8_t i = 0; i < Size; i++)
+	{
+		buffer[head] = Frame[i];
+		head = (head + 1) % TELEMETRY_BUFFER_SIZE;
+	}
+	UCSR1B |= 1 << UDRIE1;
+	return true;
+}
+
+void Telemetry_Init(const uint8_t Flags)
+{
+	UBRR1 = (F_CPU / 8 / TELEMETRY_BAUD) - 1;
+	UCSR1A = 1 << U2X1;
+	UCSR1C = 1 << UCSZ11 | 1 << UCSZ10;
+	UCSR1B = 1 << TXEN1;
+
+	Telemetry_Send(TELEMETRY_START, &Flags, 1);
+}
+
+void Telemetry_Send(const uint8_t Type, const void* const Payload, const uint8_t Length)
+{
+	uint8_t frame[TELEMETRY_FRAME_MAX];
+	uint8_t size;
+	uint8_t sreg;
+
+	if (Length > TELEMETRY_PAYLOAD_MAX)
+		return;
+
+	sreg = SREG;
+	cli();
+
+	// Tell how many frames were lost first, once there's room again
+	if (dropped > 0)
+	{
+		size = Telemetry_Frame(frame, TELEMETRY_DROPPED, &dropped, sizeof(dropped));
+		if (Telemetry_Queue(frame, size))
+			dropped = 0;
+	}
+
+	size = Telemetry_Frame(frame, Type, Payload, Length);
+	if (dropped > 0 || !Telemetry_Queue(frame, size))
+		dropped++;
+
+	SREG = sreg;
+}
+
+void Telemetry_Poll(const uint32_t Now)
+{
+	if (polled && Now - last_poll > (uint32_t)COUNTERS_TICKS_PER_MS * TELEMETRY_LAG_MS)
+	{
+		uint32_t gap_us = (Now - last_poll) / (COUNTERS_TICKS_PER_MS / 1000);
+		Telemetry_Send(TELEMETRY_LAG, &gap_us, sizeof(gap_us));
+	}
+	polled = true;
+	last_poll = Now;
+	row_reports++;
+}
+
+void Telemetry_Position(const uint8_t Y, const uint8_t State)
+{
+	// MOVE and STOP alternate on every pixel, they are one state as far as telemetry goes
+	uint8_t state = State == STOP ? MOVE : State;
+
+	if (state != last_state)
+	{
+		last_state = state;
+		Telemetry_Send(TELEMETRY_STATE, &state, 1);
+		if (state == MOVE)
+		{
+			last_y = Y;
+			row_start = Telemetry_Ms();
+			row_reports = 0;
+		}
+	}
+	else if (state == MOVE && Y != last_y)
+	{
+		uint32_t now = Telemetry_Ms();
+		uint32_t ms = now - row_start;
+		uint8_t payload[5] = {Y, ms > 0xFFFF ? 0xFF : ms, ms > 0xFFFF ? 0xFF : ms >> 8, row_reports, row_reports >> 8};
+
+		Telemetry_Send(TELEMETRY_ROW, payload, sizeof(payload));
+		last_y = Y;
+		row_start = now;
+		row_reports = 0;
+	}
+}
+
+#endif
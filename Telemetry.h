@@ -0,0 +1,68 @@
+/** \file
+ *
+ *  Header file for Telemetry.c.
+ *
+ *  Every frame is sent as:
+ *    0xA5, type, payload length, time in ms since power up (4 bytes LE), payload,
+ *    CRC8 (as in _crc8_ccitt_update) of everything from the type to the end of the payload
+ *  All the fields are little endian. telemetry.py decodes the stream.
+ */
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+// Includes
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Counters.h"
+
+// Macros
+#ifndef TELEMETRY_BAUD
+#define TELEMETRY_BAUD 115200
+#endif
+// Bytes waiting to be sent. Frames that don't fit are dropped, never waited for.
+#ifndef TELEMETRY_BUFFER_SIZE
+#define TELEMETRY_BUFFER_SIZE 64
+#endif
+// Gaps between polls longer than this are reported as lag.
+#ifndef TELEMETRY_LAG_MS
+#define TELEMETRY_LAG_MS (POLLING_MS * 3)
+#endif
+
+#define TELEMETRY_SYNC 0xA5
+
+#define TELEMETRY_START      0x01 // Flags (1 byte, TELEMETRY_FLAG_*)
+#define TELEMETRY_ROW        0x02 // Row started (1 byte), ms spent on the previous one (2), reports in it (2)
+#define TELEMETRY_STATE      0x03 // State (1 byte, see State_t), MOVE and STOP are only reported as MOVE
+#define TELEMETRY_LAG        0x04 // Gap between two polls in us (4 bytes)
+#define TELEMETRY_DISCONNECT 0x05 // The host dropped the USB connection
+#define TELEMETRY_DROPPED    0x06 // Frames dropped since the last one that got through (2 bytes)
+
+#define TELEMETRY_FLAG_RESUMING   0x01
+#define TELEMETRY_FLAG_CORRECTION 0x02
+#define TELEMETRY_FLAG_PATCH      0x04
+#define TELEMETRY_FLAG_PLAN       0x08
+#define TELEMETRY_FLAG_SCRIPT     0x10
+#define TELEMETRY_FLAG_QUEUE      0x20
+
+// Function Prototypes
+#ifdef UART_TELEMETRY
+// Start the USART and send TELEMETRY_START.
+void Telemetry_Init(const uint8_t Flags);
+// The host is ready for a report at Now (from Counters_Ticks).
+void Telemetry_Poll(const uint32_t Now);
+// Where GetNextReport is after a report.
+void Telemetry_Position(const uint8_t Y, const uint8_t State);
+// Queue a frame, it is dropped if there's no room for it. Safe from interrupts.
+void Telemetry_Send(const uint8_t Type, const void* const Payload, const uint8_t Length);
+#else
+#define Telemetry_Init(Flags)
+#define Telemetry_Poll(Now)
+#define Telemetry_Position(Y, State)
+#define Telemetry_Send(Type, Payload, Length)
+#endif
+
+#endif
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+
+# Route search for plan2c.py: orders the ink runs of an image (and picks which end each one is
+# crossed from) for the least pen-up travel, by simulated annealing over 2-opt moves. Several
+# searches start from different seeds on every core, within a wall-clock budget, and the best
+# route wins.
+#
+# A run is crossed from end to end whatever the order, so only the travel between runs
+# (Manhattan, the cursor moves one pixel per step) changes. Reversing a stretch of the route
+# also flips the runs in it; only its two boundary moves change length, which makes 2-opt
+# moves cheap to try.
+
+import os, math, random, time
+from concurrent.futures import ProcessPoolExecutor
+import numpy as np
+
+# Wall-clock budget of the search, in seconds
+SECONDS = 10.0
+# Each run is tried against this many of its nearest runs
+NEIGHBOURS = 8
+# Rows looked at around a run for its neighbours
+NEIGHBOUR_ROWS = 4
+# Temperatures at the start and the end of the search, in steps of travel
+START_TEMPERATURE = 8.0
+END_TEMPERATURE = 0.05
+
+# Horizontal runs of inked pixels, as (y, x0, x1) in rows order
+def runs(bits):
+  found = []
+  for y in range(bits.shape[0]):
+    row = np.concatenate(([0], bits[y].astype(np.int8), [0]))
+    edges = np.diff(row)
+    for x0, x1 in zip(np.nonzero(edges == 1)[0], np.nonzero(edges == -1)[0] - 1):
+      found.append((y, int(x0), int(x1)))
+  return found
+
+# Start route: row by row, each row's runs from the end nearest to the cursor. Returns the
+# entry x, exit x and y of each run, in route order.
+def rows_route(strokes):
+  entry, exit, ys = [], [], []
+  x = 0
+  i = 0
+  while i < len(strokes):
+    j = i
+    while j < len(strokes) and strokes[j][0] == strokes[i][0]:
+      j += 1
+    row = strokes[i:j]
+    if abs(x - row[0][1]) > abs(x - row[-1][2]):
+      row = [(y, x1, x0) for y, x0, x1 in reversed(row)]
+    for y, a, b in row:
+      entry.append(a)
+      exit.append(b)
+      ys.append(y)
+    x = exit[-1]
+    i = j
+  return entry, exit, ys
+
+def travel(entry, exit, ys):
+  total = entry[0] + ys[0] if entry else 0
+  for i in range(1, len(entry)):
+    total += abs(exit[i - 1] - entry[i]) + abs(ys[i - 1] - ys[i])
+  return total
+
+# The NEIGHBOURS nearest runs of each run, by the distance between their nearest ends
+def neighbours(strokes):
+  ys = np.array([s[0] for s in strokes])
+  x0 = np.array([s[1] for s in strokes])
+  x1 = np.array([s[2] for s in strokes])
+  near = []
+  for i in range(len(strokes)):
+    lo, hi = np.searchsorted(ys, [ys[i] - NEIGHBOUR_ROWS, ys[i] + NEIGHBOUR_ROWS + 1])
+    gap = np.maximum(np.maximum(x0[lo:hi] - x1[i], x0[i] - x1[lo:hi]), 0) + np.abs(ys[lo:hi] - ys[i])
+    gap[i - lo] = 1 << 30
+    order = np.argsort(gap, kind="stable")[:NEIGHBOURS]
+    near.append([int(lo + k) for k in order if gap[k] < 1 << 30])
+  return near
+
+# One annealing run from the rows route. Returns its best travel and route.
+def search(strokes, near, seconds, seed):
+  rng = random.Random(seed)
+  entry, exit, ys = rows_route(strokes)
+  n = len(entry)
+  # Run at each position, and position of each run (runs are numbered in rows order, which is
+  # also the order of the rows route)
+  order = list(range(n))
+  pos = list(range(n))
+  cost = travel(entry, exit, ys)
+  best = (cost, entry[:], exit[:], ys[:])
+
+  def d(i, x, y):
+    # Travel from the exit of position i (the top left corner before the first) to (x, y)
+    return abs(x) + y if i < 0 else abs(exit[i] - x) + abs(ys[i] - y)
+
+  start = time.monotonic()
+  temperature = START_TEMPERATURE
+  iteration = 0
+  while n > 1:
+    iteration += 1
+    if iteration % 2000 == 0:
+      elapsed = (time.monotonic() - start) / seconds
+      if cost < best[0]:
+        best = (cost, entry[:], exit[:], ys[:])
+      if elapsed >= 1:
+        break
+      temperature = START_TEMPERATURE * (END_TEMPERATURE / START_TEMPERATURE) ** elapsed
+
+    # Reverse positions i..j so a run comes right after one of its neighbours, or flip one run
+    p = pos[rng.randrange(n)]
+    if rng.random() < 0.1 or not near[order[p]]:
+      i = j = p
+    else:
+      q = pos[rng.choice(near[order[p]])]
+      i, j = (p + 1, q) if q > p else (q, p - 1)
+      if i > j:
+        continue
+
+    delta = d(i - 1, exit[j], ys[j]) - d(i - 1, entry[i], ys[i])
+    if j + 1 < n:
+      delta += abs(entry[i] - entry[j + 1]) + abs(ys[i] - ys[j + 1]) \
+        - abs(exit[j] - entry[j + 1]) - abs(ys[j] - ys[j + 1])
+    if delta > 0 and rng.random() >= math.exp(-delta / temperature):
+      continue
+
+    entries, exits = entry[i:j + 1], exit[i:j + 1]
+    entry[i:j + 1], exit[i:j + 1] = exits[::-1], entries[::-1]
+    ys[i:j + 1] = ys[i:j + 1][::-1]
+    order[i:j + 1] = order[i:j + 1][::-1]
+    for k in range(i, j + 1):
+      pos[order[k]] = k
+    cost += delta
+
+  if cost < best[0]:
+    best = (cost, entry, exit, ys)
+  return best
+
+# Best route over the image's runs found in seconds, with a search per core. Returns the
+# path (the ends of the runs in order, from the top left corner), its travel, and the travel
+# of the rows route it started from.
+def route(bits, seconds=SECONDS):
+  strokes = runs(bits)
+  if not strokes:
+    return [], 0, 0
+  near = neighbours(strokes)
+  workers = os.cpu_count() or 1
+  with ProcessPoolExecutor(workers) as pool:
+    results = list(pool.map(search, [strokes] * workers, [near] * workers, [seconds] * workers, range(workers)))
+  cost, entry, exit, ys = min(results, key=lambda r: r[0])
+
+  path = [(0, 0)]
+  for a, b, y in zip(entry, exit, ys):
+    path += [(a, y), (b, y)]
+  return path, cost, travel(*rows_route(strokes))
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+
+# Flash and SRAM budget: reads the linker map of a build for each MCU, shows how much each part of
+# the firmware takes, and fails if a build doesn't fit. Run it with "make budget".
+
+import sys, os, re, getopt
+
+# Flash left to the firmware next to the bootloader, SRAM and EEPROM, in bytes
+TARGETS = {
+  "at90usb1286": (130048, 8192, 4096), # Teensy 2.0++, HalfKay takes 1 KB
+  "atmega32u4": (28672, 2560, 1024),   # Arduino Micro, Caterina takes 4 KB
+  "atmega16u2": (12288, 512, 512),     # Arduino UNO R3, the DFU bootloader takes 4 KB
+}
+# SRAM kept free for the stack: USB control requests, GetNextReport and interrupts
+STACK_RESERVE = 128
+
+# Output sections, and what they take: .data is copied from flash to SRAM at startup
+REGIONS = {
+  ".text": ("flash",),
+  ".rodata": ("flash",),
+  ".data": ("flash", "sram"),
+  ".bss": ("sram",),
+  ".noinit": ("sram",),
+  ".eeprom": ("eeprom",),
+}
+
+# Lookup tables of the planner, kept apart from its code
+INDICES = re.compile(r"^(rowsToCorrect|fullRowsToCorrect|linesToCorrect|rectsToCorrect|.*Index|.*Table)$")
+
+COMPONENTS = ["image data", "patch data", "plan data", "script data", "queue data", "indices", "planner", "script VM", "checkpoint", "instrumentation",
+              "descriptors", "LUFA", "runtime", "other"]
+
+def component(path, section):
+  name = os.path.basename(path)
+  symbol = section.rsplit(".", 1)[-1]
+  if "LUFA" in path:
+    return "LUFA"
+  if name.startswith("image."):
+    return "image data"
+  if name.startswith("patch."):
+    return "patch data"
+  if name.startswith("plan."):
+    return "plan data"
+  if name.startswith("script."):
+    return "script data"
+  if name.startswith("queue."):
+    return "queue data"
+  if name.startswith("ScriptVM."):
+    return "script VM"
+  if name.startswith("Joystick."):
+    return "indices" if INDICES.match(symbol) else "planner"
+  if name.startswith("Checkpoint."):
+    return "checkpoint"
+  if name.startswith(("Counters.", "Telemetry.")):
+    return "instrumentation"
+  if name.startswith("Descriptors."):
+    return "descriptors"
+  if "libgcc" in path or "libc" in path or "crt" in name or "avr" in path:
+    return "runtime"
+  return "other"
+
+# Bytes per (component, region) from a GNU ld map file
+def parse_map(path):
+  usage = {}
+  output = None
+  pending = None
+  in_map = False
+  for line in open(path):
+    line = line.rstrip("\n")
+    if line.startswith("Linker script and memory map"):
+      in_map = True
+      continue
+    if not in_map or not line.strip():
+      continue
+    if not line.startswith(" "):
+      # An output section, like ".text           0x00000000     0x1f3a"
+      output = line.split()[0]
+      pending = None
+      continue
+    fields = line.split()
+    # An input section, its address, size and file on one line or the next one
+    if line.startswith(" .") and len(fields) == 1:
+      pending = fields[0]
+      continue
+    if line.startswith(" .") and len(fields) >= 4 and fields[1].startswith("0x") and fields[2].startswith("0x"):
+      section, size, source = fields[0], int(fields[2], 16), " ".join(fields[3:])
+    elif pending and len(fields) >= 3 and fields[0].startswith("0x") and fields[1].startswith("0x"):
+      section, size, source = pending, int(fields[1], 16), " ".join(fields[2:])
+    else:
+      pending = None
+      continue
+    pending = None
+    regions = next((r for o, r in REGIONS.items() if output == o or (output or "").startswith(o + ".")), ())
+    for region in regions:
+      key = (component(source, section), region)
+      usage[key] = usage.get(key, 0) + size
+  return usage
+
+def report(mcu, path, stack):
+  flash_max, sram_max, eeprom_max = TARGETS[mcu]
+  usage = parse_map(path)
+  total = lambda region: sum(v for (c, r), v in usage.items() if r == region)
+  flash, sram, eeprom = total("flash"), total("sram"), total("eeprom")
+  fits = flash <= flash_max and sram <= sram_max - stack and eeprom <= eeprom_max
+
+  print("{}: flash {} / {} ({:.0f}%), SRAM {} / {} ({:.0f}%, {} kept for the stack), EEPROM {} / {}{}".format(
+    mcu, flash, flash_max, 100.0 * flash / flash_max, sram, sram_max, 100.0 * sram / sram_max, stack,
+    eeprom, eeprom_max, "" if fits else "  DOES NOT FIT"))
+  print("  {:<16} {:>7} {:>7}".format("", "flash", "SRAM"))
+  for c in COMPONENTS:
+    f, s = usage.get((c, "flash"), 0), usage.get((c, "sram"), 0)
+    if f or s:
+      print("  {:<16} {:>7} {:>7}".format(c, f, s))
+  return fits
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hs:")
+  stack = STACK_RESERVE
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-s':
+      stack = int(arg)
+
+  if not args:
+    usage()
+    sys.exit(1)
+
+  fits = True
+  for arg in args:
+    mcu, _, path = arg.partition("=")
+    if mcu not in TARGETS:
+      print("Unknown MCU {}, pick one of {}".format(mcu, ", ".join(TARGETS)))
+      sys.exit(1)
+    fits &= report(mcu, path, stack)
+  if not fits:
+    sys.exit(1)
+
+def usage():
+  print("To check some builds: budget.py atmega16u2=Joystick_atmega16u2.map at90usb1286=Joystick.map")
+  print("To keep another amount of SRAM for the stack: budget.py -s 192 atmega16u2=Joystick.map")
+  print("\"make budget\" builds every supported MCU and checks them all")
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+
+# Read the performance counters of a printer built with -DPERF_COUNTERS, or the timing trace of
+# one built with -DTIMING_TRACE, on Linux through hidraw. Plug the printer into the PC instead of
+# the Switch (it prints blindly all the same). The timing trace can also be read from a dump of
+# the timing variable, like the one profile/ saves from simavr.
+
+import sys, os, glob, getopt, fcntl, struct, time
+
+VENDOR_ID = 0x0F0D
+PRODUCT_ID = 0x0092
+REPORT_ID = 0x43
+TIMING_REPORT_ID = 0x54
+# Counters_t in Counters.h
+FORMAT = "<BIIIIHBBII"
+FIELDS = ["reports", "echoes", "missed_polls", "max_gap_us", "x", "y", "state", "report_cycles", "max_report_cycles"]
+# Timing_t, followed by Size TimingEvent_t
+TIMING_FORMAT = "<BBB16I"
+EVENT_FORMAT = "<IBB"
+EVENT_POLL = 0x01
+EVENT_STATE = 0x02
+TICKS_PER_US = 2 # Timer1 at 16 MHz / 8
+STATES = ["SYNC_CONTROLLER", "SYNC_POSITION", "RESUME_POSITION", "BULK_ERASE", "MOVE", "STOP", "DONE", "SCRIPT", "QUEUE"]
+
+def HIDIOCGFEATURE(length):
+  return (3 << 30) | (length << 16) | (ord('H') << 8) | 0x07
+
+# The hidraw node of the first printer found
+def find_device():
+  for uevent in sorted(glob.glob("/sys/class/hidraw/hidraw*/device/uevent")):
+    for line in open(uevent):
+      if line.startswith("HID_ID="):
+        _, vendor, product = line.strip()[len("HID_ID="):].split(":")
+        if int(vendor, 16) == VENDOR_ID and int(product, 16) == PRODUCT_ID:
+          return "/dev/" + uevent.split("/")[4]
+  return None
+
+def read_feature(fd, report_id, length):
+  buf = bytearray(length)
+  buf[0] = report_id
+  fcntl.ioctl(fd, HIDIOCGFEATURE(len(buf)), buf)
+  if buf[0] != report_id:
+    raise IOError("no report 0x{:02x} in the reply, was the firmware built with the option?".format(report_id))
+  return bytes(buf)
+
+def read_counters(fd):
+  values = struct.unpack(FORMAT, read_feature(fd, REPORT_ID, struct.calcsize(FORMAT)))
+  return dict(zip(FIELDS, values[1:]))
+
+# The largest trace the firmware can be built with, the reply is cut to its actual size
+def read_timing(fd):
+  return read_feature(fd, TIMING_REPORT_ID, struct.calcsize(TIMING_FORMAT) + 255 * struct.calcsize(EVENT_FORMAT))
+
+def state_name(state):
+  return STATES[state] if state < len(STATES) else str(state)
+
+def show_timing(data):
+  header = struct.unpack_from(TIMING_FORMAT, data)
+  if header[0] != TIMING_REPORT_ID:
+    raise IOError("not a timing trace")
+  size, next_event, histogram = header[1], header[2], header[3:]
+  offset = struct.calcsize(TIMING_FORMAT)
+  events = [struct.unpack_from(EVENT_FORMAT, data, offset + i * struct.calcsize(EVENT_FORMAT)) for i in range(size)]
+  # Oldest first, the slots never written are all zero
+  events = [e for e in events[next_event:] + events[:next_event] if e[1] != 0]
+
+  print("Poll gaps:")
+  for i, count in enumerate(histogram):
+    if count:
+      print("  {:>6}-{:<6} us  {}".format(1 << i, (2 << i) - 1, count))
+  print("Last events:")
+  last = None
+  for time_ticks, event, value in events:
+    delta = "" if last is None else "+{:.3f} ms".format(((time_ticks - last) & 0xFFFFFFFF) / TICKS_PER_US / 1000)
+    what = "poll" if event == EVENT_POLL else "state " + state_name(value) if event == EVENT_STATE else "?"
+    print("  {:>12.3f} ms  {:<12} {}".format(time_ticks / TICKS_PER_US / 1000, delta, what))
+    last = time_ticks
+
+def show(c, last=None, interval=None):
+  state = state_name(c["state"])
+  line = "reports {reports} (echoes {echoes})  missed polls {missed_polls}  max gap {max_gap_us} us  ".format(**c)
+  line += "at {},{} {}  GetNextReport {} cycles (max {})".format(c["x"], c["y"], state, c["report_cycles"], c["max_report_cycles"])
+  if last is not None:
+    line += "  {:.1f} reports/s".format((c["reports"] - last["reports"]) / interval)
+  print(line)
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hw:tf:")
+  interval = None
+  timing = False
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-w':
+      interval = float(arg)
+    elif opt == '-t':
+      timing = True
+    elif opt == '-f':
+      show_timing(open(arg, 'rb').read())
+      return
+
+  device = args[0] if args else find_device()
+  if device is None:
+    print("No printer found, give its /dev/hidraw* node")
+    sys.exit(1)
+
+  fd = os.open(device, os.O_RDWR)
+  try:
+    if timing:
+      show_timing(read_timing(fd))
+      return
+    last = None
+    while True:
+      c = read_counters(fd)
+      show(c, last, interval)
+      if interval is None:
+        break
+      last = c
+      time.sleep(interval)
+  except KeyboardInterrupt:
+    pass
+  finally:
+    os.close(fd)
+
+def usage():
+  print("To read the counters once: counters.py [/dev/hidrawN]")
+  print("To read them every second: counters.py -w 1 [/dev/hidrawN]")
+  print("To read the timing trace: counters.py -t [/dev/hidrawN]")
+  print("To read a timing trace dumped from simavr: counters.py -f profile/profile_atmega16u2.timing")
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
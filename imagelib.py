@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+
+# Helpers shared by the image converters: loading a post as a bilevel NumPy array and packing
+# it into image.c, in the 1bpp LSB-first layout Joystick.c reads.
+
+import os
+import numpy as np
+from PIL import Image
+import dither
+
+WIDTH = 320
+HEIGHT = 120
+
+# Each step is a move and a stop report, sent 3 times each (ECHOES = 2) every 8 ms
+SECONDS_PER_STEP = 2 * 3 * 0.008
+# Controller and position sync before the first step, and the homing moves (from the simulator)
+SYNC_SECONDS = 9.0
+
+C_HEADER = "#include <stdint.h>\n#include <avr/pgmspace.h>\n\n"
+
+# Load a 320x120 .png as a HEIGHT x WIDTH grey array, 0 for black to 1 for white
+def load_gray(path):
+  im = Image.open(path)
+  if not (im.size[0] == WIDTH and im.size[1] == HEIGHT):
+    raise ValueError(path + ": image must be 320px by 120px")
+  return np.asarray(im.convert("L"), dtype=float) / 255
+
+# Load a 320x120 .png as a HEIGHT x WIDTH bool array, True where the pixel is inked. Grey pixels
+# are dithered with one of dither.MODES, by default PIL's own bilevel conversion.
+def load_png(path, mode="fs"):
+  if mode != "fs":
+    return dither.MODES[mode](load_gray(path))
+  im = Image.open(path)
+  if not (im.size[0] == WIDTH and im.size[1] == HEIGHT):
+    raise ValueError(path + ": image must be 320px by 120px")
+  return ~np.asarray(im.convert("1"), dtype=bool)
+
+# Load a .data file with one byte per pixel, non-zero bytes are inked
+def load_data(path):
+  data = np.fromfile(path, dtype=np.uint8)
+  if data.size < WIDTH * HEIGHT:
+    raise ValueError(path + ": expected {} bytes, got {}".format(WIDTH * HEIGHT, data.size))
+  return data[:WIDTH * HEIGHT].reshape(HEIGHT, WIDTH) != 0
+
+# Load the image back from an image.c written by png2c.py or bin2c.py
+def load_image_c(path):
+  text = open(path).read()
+  body = text[text.index("{", text.index("image_data")) + 1:text.rindex("}")]
+  data = np.array([int(v, 16) for v in body.replace(",", " ").split()], dtype=np.uint8)
+  if data.size < WIDTH * HEIGHT // 8:
+    raise ValueError(path + ": image_data is too short")
+  return np.unpackbits(data[:WIDTH * HEIGHT // 8], bitorder='little').reshape(HEIGHT, WIDTH) != 0
+
+def load(path, invert=False):
+  if path.endswith(".data"):
+    bits = load_data(path)
+  elif path.endswith(".c"):
+    bits = load_image_c(path)
+  else:
+    bits = load_png(path)
+  return ~bits if invert else bits
+
+def image_name(path):
+  return os.path.splitext(os.path.basename(path))[0]
+
+# Pack 8 pixels per byte, the first pixel of a row in bit 0
+def pack(bits):
+  return np.packbits(np.asarray(bits, dtype=bool).ravel(), bitorder='little')
+
+def image_c(bits):
+  data = pack(bits)
+  return (C_HEADER + "const uint8_t image_data[0x{:x}] PROGMEM = {{".format(data.size + 1)
+          + "".join(map("{:#x}, ".format, data.tolist())) + "0x0};\n")
+
+def write_image_c(bits, path):
+  with open(path, 'w') as f:
+    f.write(image_c(bits))
+
+# Print time of the serpentine, which visits every pixel whatever the image
+def serpentine_seconds():
+  return SYNC_SECONDS + WIDTH * HEIGHT * SECONDS_PER_STEP
+
+# Cursor steps of a patch that only inks the given pixels on a clear canvas, in the serpentine
+# order of patch2c.py (it may find a shorter greedy route for small patches)
+def patch_route_steps(bits):
+  ys, xs = np.nonzero(np.asarray(bits, dtype=bool))
+  if xs.size == 0:
+    return 0
+  order = np.lexsort((np.where(ys % 2 == 0, xs, -xs), ys))
+  xs = np.concatenate(([0], xs[order]))
+  ys = np.concatenate(([0], ys[order]))
+  return int(np.maximum(np.abs(np.diff(xs)) + np.abs(np.diff(ys)), 1).sum())
+
+def patch_seconds(bits):
+  return SYNC_SECONDS + patch_route_steps(bits) * SECONDS_PER_STEP
+
+# Where each of the converted inputs is saved: image.c (or the -o file) for a single input,
+# <name>.c in the -o directory for several
+def output_paths(inputs, output=None):
+  if len(inputs) == 1:
+    return [output or "image.c"]
+  directory = output or "."
+  os.makedirs(directory, exist_ok=True)
+  return [os.path.join(directory, image_name(i) + ".c") for i in inputs]
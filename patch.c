@@ -0,0 +1,5 @@
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+const uint16_t patch_length = 0;
+const uint8_t patch_data[] PROGMEM = {0x0};
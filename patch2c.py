@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+
+import sys, getopt
+from PIL import Image
+
+WIDTH = 320
+HEIGHT = 120
+# Each step is a move and a stop report, sent 3 times each (ECHOES = 2) every 8 ms
+SECONDS_PER_STEP = 2 * 3 * 0.008
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hic")
+  invertColormap = False
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-i':
+      invertColormap = True
+    elif opt == '-c':
+      write_patch([])
+      print("Empty patch saved to patch.c")
+      return
+
+  target = load(args[0], invertColormap)
+  canvas = load(args[1], False) if len(args) > 1 else [[0] * WIDTH for _ in range(HEIGHT)]
+
+  entries = []
+  for y in range(HEIGHT):
+    for x in range(WIDTH):
+      if target[y][x] != canvas[y][x]:
+        entries.append((x, y, target[y][x]))
+
+  entries, steps = route(entries)
+  write_patch(entries)
+
+  inked = sum(1 for e in entries if e[2])
+  print("{} pixels to fix ({} to ink, {} to erase) saved to patch.c".format(len(entries), inked, len(entries) - inked))
+  print("{} moves, about {:.0f} s of printing".format(steps, steps * SECONDS_PER_STEP))
+
+# Load a 320x120 .png, or a .data file with one byte per pixel, as rows of 1 (black) and 0 (white)
+def load(path, invert):
+  if path.endswith(".data"):
+    data = open(path, 'rb').read()
+    px = lambda x, y: 1 if data[y * WIDTH + x] else 0
+  else:
+    im = Image.open(path)
+    if not (im.size[0] == WIDTH and im.size[1] == HEIGHT):
+      print("ERROR: Image must be 320px by 120px!")
+      sys.exit()
+    im_px = im.convert("1").load()
+    px = lambda x, y: 0 if im_px[x, y] == 255 else 1
+  return [[px(x, y) ^ invert for x in range(WIDTH)] for y in range(HEIGHT)]
+
+def distance(a, b):
+  # The cursor only moves horizontally or vertically, one pixel per step
+  return abs(a[0] - b[0]) + abs(a[1] - b[1])
+
+def route_length(entries):
+  pos = (0, 0)
+  steps = 0
+  for e in entries:
+    steps += max(distance(pos, e), 1)
+    pos = e
+  return steps
+
+# Order the entries for a short cursor route, starting from the top left corner.
+# Tries a serpentine over the rows and, for small patches, a greedy nearest neighbour walk.
+def route(entries):
+  best = sorted(entries, key=lambda e: (e[1], e[0] if e[1] % 2 == 0 else -e[0]))
+
+  if len(entries) <= 2000:
+    left = list(entries)
+    greedy = []
+    pos = (0, 0)
+    while left:
+      i = min(range(len(left)), key=lambda i: distance(pos, left[i]))
+      pos = left.pop(i)
+      greedy.append(pos)
+    if route_length(greedy) < route_length(best):
+      best = greedy
+
+  return best, route_length(best)
+
+def write_patch(entries):
+  data = []
+  for x, y, ink in entries:
+    data += [x & 0xFF, (x >> 8) | (0x80 if ink else 0), y]
+
+  str_out = "#include <stdint.h>\n#include <avr/pgmspace.h>\n\n"
+  str_out += "const uint16_t patch_length = {};\n".format(len(entries))
+  str_out += "const uint8_t patch_data[] PROGMEM = {"
+  str_out += "".join(hex(val) + ", " for val in data) + "0x0};\n"
+
+  with open('patch.c', 'w') as f:
+    f.write(str_out)
+
+def usage():
+  print("To touch up a printed post: patch2c.py <newImage.png> <printedImage.png>")
+  print("To print only the black pixels on the current canvas: patch2c.py <yourImage.png>")
+  print("To use an inverted colormap for the new image: patch2c.py -i <newImage.png> <printedImage.png>")
+  print("To go back to normal printing: patch2c.py -c")
+  print("Images can also be .data files with one byte per pixel")
+
+if __name__ == "__main__":
+  if len(sys.argv[1:]) == 0:
+    usage()
+    sys.exit()
+  else:
+    main(sys.argv[1:])
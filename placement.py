@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+
+# Placement of images of any size on the canvas for png2c.py: scaled down to fit with blank
+# bands around (letterbox), scaled up to fill it and cropped, or in between, at a few sizes and
+# anchors. Each placement gives the grey canvas that png2c.py then dithers.
+
+from collections import namedtuple
+import numpy as np
+from PIL import Image
+import imagelib
+
+WIDTH = imagelib.WIDTH
+HEIGHT = imagelib.HEIGHT
+
+# Sizes tried at and below the one that fits the whole image, as a share of it
+SIZES = [1.0, 0.9, 0.8, 0.7, 0.6, 0.5]
+# Steps from fitting to filling the canvas, 1.0 fills it and crops the most
+CROPS = [0.25, 0.5, 0.75, 1.0]
+# Where the image goes in the room left (or cut off) on each axis: start, centre, end
+ANCHORS = [0.0, 0.5, 1.0]
+
+# Scale from image to canvas pixels, anchors on both axes, the size as a share of the fitting
+# one, and the share of the image that is cropped away
+Placement = namedtuple("Placement", "scale ax ay size crop")
+
+def describe(p):
+  names = {0.0: "start", 0.5: "centre", 1.0: "end"}
+  return "{:>3.0f}% size, {:>2.0f}% cropped, anchored {:<6} / {:<6}".format(
+    100 * p.size, 100 * p.crop, names[p.ax], names[p.ay])
+
+def make(w, h, scale, ax, ay):
+  fit = min(WIDTH / w, HEIGHT / h)
+  sw, sh = max(1, round(w * scale)), max(1, round(h * scale))
+  shown = min(sw, WIDTH) * min(sh, HEIGHT)
+  return Placement(scale, ax, ay, scale / fit, 1 - shown / (sw * sh))
+
+# Where the top left corner of the scaled image goes, negative when it is cropped
+def offset(w, h, p):
+  sw, sh = max(1, round(w * p.scale)), max(1, round(h * p.scale))
+  return round(p.ax * (WIDTH - sw)), round(p.ay * (HEIGHT - sh))
+
+# Placements of a w x h image: "letterbox" fits it whole, centred, "crop" fills the canvas,
+# centred, and "auto" tries every size and anchor within the limits (the smallest size, and the
+# largest share cropped away, both from 0 to 1)
+def candidates(w, h, fit="auto", min_size=1.0, max_crop=0.0):
+  fit_scale = min(WIDTH / w, HEIGHT / h)
+  fill_scale = max(WIDTH / w, HEIGHT / h)
+  if fit == "letterbox":
+    return [make(w, h, fit_scale, 0.5, 0.5)]
+  if fit == "crop":
+    return [make(w, h, fill_scale, 0.5, 0.5)]
+
+  scales = [fit_scale * s for s in SIZES if s >= min_size - 1e-9]
+  scales += [fit_scale + (fill_scale - fit_scale) * c for c in CROPS]
+  found = {}
+  for scale in scales:
+    for ax in ANCHORS:
+      for ay in ANCHORS:
+        p = make(w, h, scale, ax, ay)
+        # Anchors along an axis without room give the same placement
+        key = (round(scale, 6), offset(w, h, p))
+        if p.crop <= max_crop + 1e-9 and key not in found:
+          found[key] = p
+  return list(found.values())
+
+# The grey canvas (0 black to 1 white) with the image placed on it, blank is the grey of the
+# room left around it
+def render(im, p, blank=1.0):
+  w, h = im.size
+  sw, sh = max(1, round(w * p.scale)), max(1, round(h * p.scale))
+  canvas = Image.new("L", (WIDTH, HEIGHT), round(blank * 255))
+  canvas.paste(im.convert("L").resize((sw, sh), Image.LANCZOS), offset(w, h, p))
+  return np.asarray(canvas, dtype=float) / 255
@@ -0,0 +1,5 @@
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+const uint16_t plan_length = 0;
+const uint8_t plan_data[] PROGMEM = {0x0};
@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+
+# Move plan compiler: plans the cursor route over an image on the PC and saves it to plan.c as
+# a stream of one byte ops, which the firmware plays back (see "Plan mode" in Joystick.c).
+
+import sys, getopt
+import numpy as np
+import imagelib, anneal
+
+WIDTH = imagelib.WIDTH
+HEIGHT = imagelib.HEIGHT
+
+# Ops, the same as PLAN_* in Joystick.h. Directions are indices in planHatTable (Joystick.c).
+RIGHT, LEFT, DOWN, UP = range(4)
+PLAN_MOVE = 0x0
+PLAN_MOVE_INK = 0x4
+PLAN_INK = 0x8
+PLAN_MASK = 0x9
+DELTAS = {RIGHT: (1, 0), LEFT: (-1, 0), DOWN: (0, 1), UP: (0, -1)}
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hics:o:t:")
+  invertColormap = False
+  strategy = "spans"
+  output = "plan.c"
+  options = {}
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-i':
+      invertColormap = True
+    elif opt == '-s':
+      strategy = arg
+    elif opt == '-o':
+      output = arg
+    elif opt == '-t':
+      options["seconds"] = float(arg)
+    elif opt == '-c':
+      write_plan(b"", output)
+      print("Empty plan saved to {}".format(output))
+      return
+
+  if strategy not in STRATEGIES:
+    print("ERROR: unknown strategy {}, pick one of {}".format(strategy, ", ".join(STRATEGIES)))
+    sys.exit(1)
+
+  try:
+    bits = imagelib.load(args[0], invertColormap)
+  except (ValueError, OSError) as e:
+    print("ERROR: {}".format(e))
+    sys.exit(1)
+
+  steps, ops = compile_plan(bits, strategy, **(options if strategy == "anneal" else {}))
+  write_plan(ops, output)
+
+  print("{} planned with {} and saved to {}: {} moves in {} bytes".format(args[0], strategy, output, len(steps), len(ops)))
+  if not bits.any():
+    print("Nothing to ink: the printer clears the canvas, moves once and stops")
+    return
+  print("About {:.1f} min of printing, the serpentine takes {:.1f} min ({:.0f}% saved)".format(
+    seconds(steps) / 60, imagelib.serpentine_seconds() / 60, 100 * (1 - seconds(steps) / imagelib.serpentine_seconds())))
+
+# A plan is a list of steps (direction, ink), direction None to ink where the cursor already is.
+# The cursor starts at the top left corner of a cleared canvas.
+
+def seconds(steps):
+  return imagelib.SYNC_SECONDS + len(steps) * imagelib.SECONDS_PER_STEP
+
+# Move from (x, y) to (tx, ty) without inking, vertically first so the cursor stays in columns
+# it has already crossed
+def travel(x, y, tx, ty):
+  steps = [(DOWN if ty > y else UP, False)] * abs(ty - y)
+  return steps + [(RIGHT if tx > x else LEFT, False)] * abs(tx - x)
+
+# Walk a path of positions, inking each black pixel the first time the cursor gets on it
+def walk(path, bits):
+  inked = np.zeros(bits.shape, dtype=bool)
+  steps = []
+  x, y = path[0]
+  if bits[y, x]:
+    steps.append((None, True))
+    inked[y, x] = True
+  for nx, ny in path[1:]:
+    for direction, _ in travel(x, y, nx, ny):
+      dx, dy = DELTAS[direction]
+      x, y = x + dx, y + dy
+      ink = bool(bits[y, x] and not inked[y, x])
+      inked[y, x] |= ink
+      steps.append((direction, ink))
+  return steps
+
+# The firmware's own route: back and forth over every row
+def serpentine(bits):
+  path = []
+  for y in range(HEIGHT):
+    path += [(0, y), (WIDTH - 1, y)] if y % 2 == 0 else [(WIDTH - 1, y), (0, y)]
+  return walk(path, bits)
+
+# Only cross each row from its first to its last black pixel, skipping blank rows. Which end
+# each row starts from is picked for the shortest travel over the whole image, by dynamic
+# programming over the rows (two states per row: which end the cursor leaves from).
+def spans(bits):
+  rows = [(y, int(np.argmax(bits[y])), WIDTH - 1 - int(np.argmax(bits[y, ::-1])))
+          for y in range(HEIGHT) if bits[y].any()]
+  if not rows:
+    return []
+
+  # cost[e]: shortest travel so far, leaving the last row from end e (0 left, 1 right)
+  y, x0, x1 = rows[0]
+  cost = [x1 + (x1 - x0), x0 + (x1 - x0)]
+  choices = []
+  for (py, px0, px1), (y, x0, x1) in zip(rows, rows[1:]):
+    exits = (px0, px1)
+    new, choice = [], []
+    for e, (entry, leave) in enumerate(((x1, x0), (x0, x1))):
+      options = [cost[p] + abs(exits[p] - entry) for p in (0, 1)]
+      p = int(np.argmin(options))
+      new.append(options[p] + (x1 - x0))
+      choice.append(p)
+    cost = new
+    choices.append(choice)
+
+  # Back from the cheapest end of the last row
+  ends = [int(np.argmin(cost))]
+  for choice in reversed(choices):
+    ends.append(choice[ends[-1]])
+  ends.reverse()
+
+  path = [(0, 0)]
+  for (y, x0, x1), e in zip(rows, ends):
+    path += [(x1, y), (x0, y)] if e == 0 else [(x0, y), (x1, y)]
+  return walk(path, bits)
+
+# Cross the runs of black pixels in the order, and from the ends, with the least travel, as
+# found by a search on every core within a time budget (see anneal.py). Runs that are apart on
+# the same row are crossed separately, so the route can finish a shape before the next one.
+def annealed(bits, seconds=anneal.SECONDS):
+  path = anneal.route(bits, seconds)[0]
+  return walk(path, bits) if path else []
+
+STRATEGIES = {
+  "serpentine": serpentine,
+  "spans": spans,
+  "anneal": annealed,
+}
+
+# Plan an image with a strategy, returns the steps and the op stream. Options go to the strategy.
+# With nothing to ink the plan still takes one move, an empty plan.c is normal printing.
+def compile_plan(bits, strategy, **options):
+  steps = STRATEGIES[strategy](bits, **options) or [(RIGHT, False)]
+  check(steps, bits)
+  return steps, encode(steps)
+
+# Every black pixel is inked, and nothing else
+def check(steps, bits):
+  canvas = np.zeros(bits.shape, dtype=bool)
+  x = y = 0
+  for direction, ink in steps:
+    if direction is not None:
+      dx, dy = DELTAS[direction]
+      x, y = x + dx, y + dy
+      if not (0 <= x < WIDTH and 0 <= y < HEIGHT):
+        raise ValueError("the plan leaves the canvas at ({}, {})".format(x, y))
+    canvas[y, x] |= ink
+  if (canvas != bits).any():
+    raise ValueError("the plan misses {} pixels".format(int((canvas != bits).sum())))
+
+# Shortest op stream for the steps: a run op covers up to 16 moves in the same direction that
+# all ink or all don't, a mask op covers 4 moves in the same direction with any ink pattern
+def encode(steps):
+  n = len(steps)
+  size = [0] * (n + 1)
+  pick = [None] * n
+  for i in range(n - 1, -1, -1):
+    direction, ink = steps[i]
+    if direction is None:
+      size[i], pick[i] = size[i + 1] + 1, ("ink", 1)
+      continue
+    run = 1
+    while run < 16 and i + run < n and steps[i + run] == steps[i]:
+      run += 1
+    best = min(((size[i + k] + 1, ("run", k)) for k in range(1, run + 1)), key=lambda c: c[0])
+    if i + 4 <= n and all(steps[i + k][0] == direction for k in range(4)) and size[i + 4] + 1 < best[0]:
+      best = (size[i + 4] + 1, ("mask", 4))
+    size[i], pick[i] = best
+
+  ops = bytearray()
+  i = 0
+  while i < n:
+    kind, k = pick[i]
+    direction, ink = steps[i]
+    if kind == "ink":
+      ops.append(PLAN_INK << 4)
+    elif kind == "run":
+      ops.append((PLAN_MOVE_INK if ink else PLAN_MOVE) + direction << 4 | k - 1)
+    else:
+      mask = sum(1 << b for b in range(4) if steps[i + b][1])
+      ops.append((PLAN_MASK + direction) << 4 | mask)
+    i += k
+  return bytes(ops)
+
+# Steps of an op stream, the other way round from encode()
+def decode(ops):
+  steps = []
+  for op in ops:
+    code, n = op >> 4, op & 0x0F
+    if code == PLAN_INK:
+      steps.append((None, True))
+    elif code >= PLAN_MASK:
+      steps += [(code - PLAN_MASK, bool(n >> b & 1)) for b in range(4)]
+    else:
+      steps += [(code & 3, code >= PLAN_MOVE_INK)] * (n + 1)
+  return steps
+
+# The op stream of a plan.c written by write_plan()
+def read_plan(path):
+  text = open(path).read()
+  length = int(text.split("plan_length =", 1)[1].split(";", 1)[0])
+  body = text[text.index("{", text.index("plan_data")) + 1:text.rindex("}")]
+  return bytes(int(v, 16) for v in body.replace(",", " ").split())[:length]
+
+def write_plan(ops, path):
+  with open(path, 'w') as f:
+    f.write(imagelib.C_HEADER)
+    f.write("const uint16_t plan_length = {};\n".format(len(ops)))
+    f.write("const uint8_t plan_data[] PROGMEM = {")
+    f.write("".join(map("{:#x}, ".format, ops)) + "0x0};\n")
+
+def usage():
+  print("To plan the print of an image: plan2c.py <yourImage.png>")
+  print("To pick a strategy: plan2c.py -s spans|serpentine|anneal <yourImage.png>")
+  print("To give the anneal search more or less time: plan2c.py -s anneal -t 30 <yourImage.png>")
+  print("To use an inverted colormap: plan2c.py -i <yourImage.png>")
+  print("To save the plan elsewhere: plan2c.py -o plan.c <yourImage.png>")
+  print("To go back to normal printing: plan2c.py -c")
+  print("Images can also be .data files with one byte per pixel")
+
+if __name__ == "__main__":
+  if len(sys.argv[1:]) == 0:
+    usage()
+    sys.exit()
+  else:
+    main(sys.argv[1:])
@@ -0,0 +1,315 @@
+#!/usr/bin/env python3
+
+# Plan visualizer: replays print routes over an image and shows where the time goes. A route is
+# planned with a plan2c.py strategy, read back from a plan.c, or taken from a report trace of the
+# simulator (sim/simulator -t). For each one it saves an animation of the cursor and a heatmap
+# of the time spent on each pixel, coloured by what it was spent on:
+#   sync    pairing, homing the cursor, walking back after a resync and saving queued posts
+#   travel  moving over pixels without inking them
+#   ink     moving onto a pixel and inking it
+#   turn    moving down or up between rows without inking
+#   erase   holding B (bulk erase and corrections)
+# With several routes, it also tells which one is faster on each region of the canvas.
+
+import sys, os, getopt, struct
+import numpy as np
+from PIL import Image, ImageDraw
+import imagelib, plan2c
+
+WIDTH = imagelib.WIDTH
+HEIGHT = imagelib.HEIGHT
+
+CATEGORIES = ["sync", "travel", "ink", "turn", "erase"]
+COLOURS = {"sync": (150, 150, 150), "travel": (40, 100, 230), "ink": (220, 40, 40),
+           "turn": (240, 180, 0), "erase": (30, 170, 80)}
+# Output pixels per canvas pixel
+SCALE = 2
+# Frames of the animation, and how long each is shown in ms
+FRAMES = 150
+FRAME_MS = 60
+# Positions the cursor trail of the animation goes back
+TRAIL = 40
+# Regions compared between routes, the canvas is cut into REGIONS_X x REGIONS_Y
+REGIONS_X = 4
+REGIONS_Y = 2
+
+# Trace format, see sim/Trace.h
+TRACE_HAS_TIME, TRACE_HAS_BUTTON, TRACE_HAS_HAT, TRACE_HAS_LX = 0x01, 0x02, 0x04, 0x08
+TRACE_HAS_LY, TRACE_HAS_RX, TRACE_HAS_RY, TRACE_HAS_TAG = 0x10, 0x20, 0x40, 0x80
+TRACE_TAG_SYNC, TRACE_TAG_RESUME, TRACE_TAG_ERASE, TRACE_TAG_MOVE = 0x00, 0x01, 0x02, 0x03
+TRACE_TAG_STOP, TRACE_TAG_DONE, TRACE_TAG_QUEUE = 0x04, 0x05, 0x07
+SWITCH_B, SWITCH_A = 0x02, 0x04
+HAT_CENTER = 8
+HAT_DX = [0, 1, 1, 1, 0, -1, -1, -1]
+HAT_DY = [-1, -1, 0, 1, 1, 1, 0, -1]
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "his:p:t:o:f:")
+  invertColormap = False
+  sources = []
+  output = "."
+  frames = FRAMES
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-i':
+      invertColormap = True
+    elif opt in ('-s', '-p', '-t'):
+      sources.append((opt, arg))
+    elif opt == '-o':
+      output = arg
+    elif opt == '-f':
+      frames = int(arg)
+
+  if not sources:
+    sources = [('-s', "spans")]
+  for opt, arg in sources:
+    if opt == '-s' and arg not in plan2c.STRATEGIES:
+      print("ERROR: unknown strategy {}, pick one of {}".format(arg, ", ".join(plan2c.STRATEGIES)))
+      sys.exit(1)
+
+  try:
+    bits = imagelib.load(args[0], invertColormap)
+    routes = [load_route(opt, arg, bits) for opt, arg in sources]
+  except (ValueError, OSError) as e:
+    print("ERROR: {}".format(e))
+    sys.exit(1)
+
+  os.makedirs(output, exist_ok=True)
+  maps = []
+  for name, events in routes:
+    time = time_map(events)
+    maps.append((name, time))
+    prefix = os.path.join(output, "{}-{}".format(imagelib.image_name(args[0]), name))
+    heatmap(time, bits, name).save(prefix + "-heat.png")
+    saved = [prefix + "-heat.png"]
+    if frames > 0:
+      animate(events, bits, frames, prefix + "-route.gif")
+      saved.append(prefix + "-route.gif")
+    print("{}: {}".format(name, ", ".join(saved)))
+    summary(events)
+  if len(maps) > 1:
+    compare(maps)
+
+def load_route(opt, arg, bits):
+  if opt == '-s':
+    return arg, steps_events(plan2c.compile_plan(bits, arg)[0])
+  if opt == '-p':
+    return os.path.splitext(os.path.basename(arg))[0], steps_events(plan2c.decode(plan2c.read_plan(arg)))
+  return os.path.splitext(os.path.basename(arg))[0], trace_events(arg)
+
+# A route is a list of events (seconds, x, y, category, paint): the time spent with the cursor
+# on (x, y), and 1 if it inks the pixel, 0 if it erases it, None if it leaves it as it is.
+
+def steps_events(steps):
+  events = [(imagelib.SYNC_SECONDS, 0, 0, "sync", None)]
+  x = y = 0
+  for direction, ink in steps:
+    if direction is not None:
+      dx, dy = plan2c.DELTAS[direction]
+      x, y = x + dx, y + dy
+    category = "ink" if ink else "turn" if direction in (plan2c.DOWN, plan2c.UP) else "travel"
+    events.append((imagelib.SECONDS_PER_STEP, x, y, category, 1 if ink else None))
+  return events
+
+def leb128(data, i):
+  value = shift = 0
+  while True:
+    byte = data[i]
+    i += 1
+    value |= (byte & 0x7F) << shift
+    shift += 7
+    if not byte & 0x80:
+      return value, i
+
+# Reports of a trace as (time in us, button, HAT, LX, LY, tag)
+def read_trace(path):
+  data = open(path, "rb").read()
+  if data[:4] != b"SPTR" or data[4] != 1:
+    raise ValueError("{} is not a version 1 trace".format(path))
+  poll = struct.unpack_from("<I", data, 8)[0]
+  records = []
+  t, button, hat, lx, ly, tag = 0, 0, HAT_CENTER, 128, 128, TRACE_TAG_SYNC
+  i = 12
+  while i < len(data):
+    flags = data[i]
+    i += 1
+    if flags & TRACE_HAS_TIME:
+      delta, i = leb128(data, i)
+    else:
+      delta = poll
+    if records:
+      t += delta
+    if flags & TRACE_HAS_BUTTON:
+      button = data[i] | data[i + 1] << 8
+      i += 2
+    fields = [hat, lx, ly]
+    for n, flag in enumerate((TRACE_HAS_HAT, TRACE_HAS_LX, TRACE_HAS_LY)):
+      if flags & flag:
+        fields[n] = data[i]
+        i += 1
+    hat, lx, ly = fields
+    i += bool(flags & TRACE_HAS_RX) + bool(flags & TRACE_HAS_RY)
+    if flags & TRACE_HAS_TAG:
+      tag = data[i]
+      i += 1
+    records.append((t, button, hat, lx, ly, tag))
+  return records, poll
+
+# The cursor is followed the way sim/Canvas.c moves it: one pixel per D-pad press, into a
+# corner or an edge when the stick is pushed there. Each report lasts until the next one, and
+# the reports from a press to the next one are a step, inking if A is held in it.
+def trace_events(path):
+  records, poll = read_trace(path)
+  events = []
+  x = y = 0
+  last_hat = HAT_CENTER
+  # First event of the current step, and what it is so far
+  step, kind = 0, "travel"
+  for n, (t, button, hat, lx, ly, tag) in enumerate(records):
+    if (tag & 0x7F) == TRACE_TAG_DONE:
+      break
+    seconds = ((records[n + 1][0] if n + 1 < len(records) else t + poll) - t) / 1e6
+    if hat < HAT_CENTER and hat != last_hat:
+      x = min(max(x + HAT_DX[hat], 0), WIDTH - 1)
+      y = min(max(y + HAT_DY[hat], 0), HEIGHT - 1)
+      step, kind = len(events), "turn" if HAT_DX[hat] == 0 else "travel"
+    last_hat = hat
+    x = 0 if lx < 64 else WIDTH - 1 if lx > 192 else x
+    y = 0 if ly < 64 else HEIGHT - 1 if ly > 192 else y
+
+    paint = 1 if button & SWITCH_A else 0 if button & SWITCH_B else None
+    if (tag & 0x7F) in (TRACE_TAG_SYNC, TRACE_TAG_RESUME, TRACE_TAG_QUEUE) or lx != 128 or ly != 128:
+      events.append([seconds, x, y, "sync", paint])
+      continue
+    if paint == 0 or (tag & 0x7F) == TRACE_TAG_ERASE:
+      found = "erase"
+    elif paint == 1 and kind != "erase":
+      found = "ink"
+    else:
+      found = kind
+    if found != kind:
+      # The whole step is what it ends up doing
+      kind = found
+      for e in events[step:]:
+        if e[3] != "sync":
+          e[3] = kind
+    events.append([seconds, x, y, kind, paint])
+  return [tuple(e) for e in events]
+
+# Seconds spent on each pixel, per category: an array of len(CATEGORIES) x HEIGHT x WIDTH
+def time_map(events):
+  time = np.zeros((len(CATEGORIES), HEIGHT, WIDTH))
+  for seconds, x, y, category, _ in events:
+    time[CATEGORIES.index(category), y, x] += seconds
+  return time
+
+def totals(events):
+  found = dict.fromkeys(CATEGORIES, 0.0)
+  for seconds, _, _, category, _ in events:
+    found[category] += seconds
+  return found
+
+def summary(events):
+  found = totals(events)
+  total = sum(found.values())
+  print("  {:.1f} min: {}".format(total / 60, ", ".join(
+    "{} {:.1f} min ({:.0f}%)".format(c, found[c] / 60, 100 * found[c] / total) for c in CATEGORIES if found[c])))
+
+# The target faint under the route, as an RGB array
+def background(bits):
+  return np.where(bits[..., None], 215, 255).repeat(3, axis=2).astype(float)
+
+# Each pixel gets the colours of its categories mixed by time, darker the longer it took (on a
+# log scale, from one step to the slowest pixel). The pairing time is left out, it is spent
+# before the cursor is anywhere on the canvas.
+def heatmap(time, bits, name):
+  shown = time.copy()
+  shown[CATEGORIES.index("sync"), 0, 0] = 0
+  total = shown.sum(axis=0)
+  colours = np.array([COLOURS[c] for c in CATEGORIES], dtype=float)
+  mix = np.einsum("cyx,cd->yxd", shown, colours) / np.maximum(total, 1e-9)[..., None]
+  level = np.log1p(total / imagelib.SECONDS_PER_STEP)
+  level /= max(level.max(), 1e-9)
+  rgb = np.where((total > 0)[..., None], 255 - (255 - mix) * (0.3 + 0.7 * level[..., None]), background(bits))
+  canvas = Image.fromarray(rgb.astype(np.uint8)).resize((WIDTH * SCALE, HEIGHT * SCALE), Image.NEAREST)
+
+  # Legend under the canvas
+  image = Image.new("RGB", (canvas.width, canvas.height + 16 * (len(CATEGORIES) + 1) + 8), "white")
+  image.paste(canvas, (0, 0))
+  draw = ImageDraw.Draw(image)
+  seconds = time.sum(axis=(1, 2))
+  top = canvas.height + 6
+  draw.text((4, top), "{}: {:.1f} min".format(name, seconds.sum() / 60), fill="black")
+  for n, c in enumerate(CATEGORIES):
+    y = top + 16 * (n + 1)
+    draw.rectangle((4, y + 2, 14, y + 12), fill=COLOURS[c])
+    draw.text((20, y), "{:<7} {:6.1f} min {:3.0f}%".format(c, seconds[n] / 60, 100 * seconds[n] / max(seconds.sum(), 1e-9)), fill="black")
+  return image
+
+# Frames at even times over the route: the pixels inked so far over the faint target, the
+# cursor and its trail
+def animate(events, bits, frames, path):
+  ends = np.cumsum([e[0] for e in events])
+  total = ends[-1] if len(ends) else 0
+  canvas = background(bits)
+  trail = []
+  images = []
+  k = 0
+  for frame in range(1, frames + 1):
+    until = total * frame / frames
+    while k < len(events) and ends[k] <= until + 1e-9:
+      _, x, y, _, paint = events[k]
+      if paint is not None:
+        canvas[y, x] = (0, 0, 0) if paint else (255, 255, 255)
+      if not trail or trail[-1] != (x, y):
+        trail = (trail + [(x, y)])[-TRAIL:]
+      k += 1
+    rgb = canvas.copy()
+    for n, (x, y) in enumerate(trail):
+      fade = (n + 1) / len(trail)
+      rgb[y, x] = rgb[y, x] * (1 - fade) + np.array((255, 140, 0)) * fade
+    image = Image.fromarray(rgb.astype(np.uint8)).resize((WIDTH * SCALE, HEIGHT * SCALE), Image.NEAREST)
+    draw = ImageDraw.Draw(image)
+    if trail:
+      x, y = trail[-1]
+      draw.rectangle((x * SCALE - 2, y * SCALE - 2, x * SCALE + SCALE + 1, y * SCALE + SCALE + 1), outline=(220, 0, 0))
+    draw.text((4, 4), "{:.1f} min".format(until / 60), fill=(220, 0, 0))
+    images.append(image.convert("P", palette=Image.ADAPTIVE))
+  images[0].save(path, save_all=True, append_images=images[1:], duration=FRAME_MS, loop=0)
+
+# Printing time (pairing left out) of each route in each region, the fastest marked with *
+def compare(maps):
+  w, h = WIDTH // REGIONS_X, HEIGHT // REGIONS_Y
+  names = [name for name, _ in maps]
+  print("{:<18}".format("region") + "".join("{:>14}".format(n[:13]) for n in names))
+  wins = dict.fromkeys(names, 0)
+  for ry in range(REGIONS_Y):
+    for rx in range(REGIONS_X):
+      spent = []
+      for _, time in maps:
+        region = time[1:, ry * h:(ry + 1) * h, rx * w:(rx + 1) * w]
+        spent.append(region.sum() / 60)
+      best = int(np.argmin(spent))
+      wins[names[best]] += 1
+      label = "x {}-{} y {}-{}".format(rx * w, (rx + 1) * w - 1, ry * h, (ry + 1) * h - 1)
+      print("{:<18}".format(label) + "".join("{:>13.1f}{}".format(s, "*" if n == best else " ") for n, s in enumerate(spent)))
+  print("Fastest on: " + ", ".join("{} {} regions".format(n, wins[n]) for n in names))
+
+def usage():
+  print("To see where the time of a plan2c.py strategy goes: planview.py -s spans <yourImage.png>")
+  print("To compare strategies region by region: planview.py -s spans -s anneal <yourImage.png>")
+  print("To view a saved plan: planview.py -p plan.c <yourImage.png>")
+  print("To view a print on the simulator: sim/simulator -t print.trace, then planview.py -t print.trace <yourImage.png>")
+  print("To save the heatmaps and animations elsewhere: planview.py -o out/ ...")
+  print("To set the frames of the animations (0 for none): planview.py -f 300 ...")
+  print("To use an inverted colormap: planview.py -i ...")
+
+if __name__ == "__main__":
+  if len(sys.argv[1:]) == 0:
+    usage()
+    sys.exit()
+  else:
+    main(sys.argv[1:])
@@ -1,77 +1,180 @@
-#!/bin/python
-
-import sys, os, getopt
-from PIL import Image
-
-def main(argv):
-  opts, args = getopt.getopt(argv, "pshi")
-  previewBilevel = False
-  saveBilevel = False
-  invertColormap = False
-
-  for opt, arg in opts:
-    if opt == '-h':
-      usage()
-      sys.exit()
-    elif opt == '-p':
-      previewBilevel = True
-    elif opt == '-s':
-      saveBilevel = True
-    elif opt == '-i':
-      invertColormap = True
-
-  im = Image.open(args[0])                # import 320x120 png
-  if not (im.size[0] == 320 and im.size[1] == 120):
-    print("ERROR: Image must be 320px by 120px!")
-    sys.exit()
-
-  im = im.convert("1")                    # convert to bilevel image
-                                          # dithering if necessary
-  if previewBilevel:
-    im.show()
-  if saveBilevel:
-    im.save("bilevel_" + args[0])
-    print("Bilevel version of " + args[0] + " saved as bilevel_" + args[0])
-  if not (previewBilevel or saveBilevel):
-    im_px = im.load()
-    data = []
-    for i in range(0,120):                # iterate over the columns
-      for j in range(0,320):              # and convert 255 vals to 0 to match logic in Joystick.c and invertColormap option
-         data.append(0 if im_px[j,i] == 255 else 1)
-
-    str_out = "#include <stdint.h>\n#include <avr/pgmspace.h>\n\nconst uint8_t image_data[0x12c1] PROGMEM = {"
-    for i in range(0, (320*120) / 8):
-       val = 0;
-
-       for j in range(0, 8):
-          val |= data[(i * 8) + j] << j
-
-       if (invertColormap):
-          val = ~val & 0xFF;
-       else:
-          val = val & 0xFF;
-
-       str_out += hex(val) + ", "         # append hexidecimal bytes
-                                          # to the output .c array
-    str_out += "0x0};\n"                  # of bytes
-
-    with open('image.c', 'w') as f:       # save output into image.c
-      f.write(str_out)
-
-    if (invertColormap):
-       print("{} converted with inverted colormap and saved to image.c".format(args[0]))
-    else:
-       print("{} converted with original colormap and saved to image.c".format(args[0]))
-
-def usage():
-  print("To convert to image.c: png2c.py <yourImage.png>")
-  print("To convert to an inverted image.c: png2c.py -i <yourImage.png>")
-  print("To preview bilevel image: png2c.py -p <yourImage.png>")
-  print("To save bilevel image: png2c.py -s <yourImage.png>")
-
-if __name__ == "__main__":
-  if len(sys.argv[1:]) == 0:
-    usage()
-    sys.exit
-  else:
-    main(sys.argv[1:])
+#!/usr/bin/env python3
+
+import sys, getopt
+from PIL import Image
+import imagelib, dither, simplify, placement, plan2c
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "pshio:d:c", ["max-minutes=", "fit=", "min-size=", "max-crop="])
+  previewBilevel = False
+  saveBilevel = False
+  invertColormap = False
+  compareModes = False
+  output = None
+  mode = "fs"
+  maxMinutes = None
+  fitMode = None
+  minSize = 100.0
+  maxCrop = 0.0
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-p':
+      previewBilevel = True
+    elif opt == '-s':
+      saveBilevel = True
+    elif opt == '-i':
+      invertColormap = True
+    elif opt == '-o':
+      output = arg
+    elif opt == '-d':
+      mode = arg
+    elif opt == '-c':
+      compareModes = True
+    elif opt == '--max-minutes':
+      maxMinutes = float(arg)
+    elif opt == '--fit':
+      fitMode = arg
+    elif opt == '--min-size':
+      minSize = float(arg)
+    elif opt == '--max-crop':
+      maxCrop = float(arg)
+
+  if mode not in dither.MODES:
+    print("ERROR: unknown dithering mode {}, pick one of {}".format(mode, ", ".join(dither.MODES)))
+    sys.exit(1)
+  if fitMode not in (None, "letterbox", "crop", "auto"):
+    print("ERROR: unknown fit {}, pick one of letterbox, crop or auto".format(fitMode))
+    sys.exit(1)
+
+  images = []
+  for path in args:                       # import 320x120 pngs, or place others with --fit
+    try:
+      images.append((path,) + load(path, mode, fitMode, minSize / 100, maxCrop / 100, invertColormap))
+    except (ValueError, OSError) as e:
+      print("ERROR: {}".format(e))
+      if fitMode is None and str(e).endswith("must be 320px by 120px"):
+        print("Add --fit letterbox, crop or auto to place images of other sizes on the canvas")
+      sys.exit(1)
+
+  if compareModes:
+    compare(images)
+    return
+
+  if maxMinutes is not None:
+    images = [(path, gray, fit(path, bits, maxMinutes, invertColormap)) for path, gray, bits in images]
+
+  if previewBilevel or saveBilevel:
+    for path, _, bits in images:
+      im = Image.fromarray(~bits)         # bilevel image, dithered if necessary
+      if previewBilevel:
+        im.show()
+      if saveBilevel:
+        im.save("bilevel_" + path)
+        print("Bilevel version of " + path + " saved as bilevel_" + path)
+    return
+
+  colormap = "inverted" if invertColormap else "original"
+  for (path, gray, bits), out in zip(images, imagelib.output_paths(args, output)):
+    printed = ~bits if invertColormap else bits
+    imagelib.write_image_c(printed, out)
+    print("{} converted with {} colormap and saved to {}".format(path, colormap, out))
+    print("  {} dither, {}, {}".format(mode, decibels(dither.quality(gray, bits)), estimate(printed)))
+
+# The grey and the dithered image. Images of any size are placed on the canvas first with
+# --fit: as asked, or with auto the placement within the limits that prints the fastest.
+def load(path, mode, fitMode, minSize, maxCrop, invertColormap):
+  if fitMode is None:
+    return imagelib.load_gray(path), imagelib.load_png(path, mode)
+  im = Image.open(path)
+  blank = 0.0 if invertColormap else 1.0  # The room around the image is left unprinted
+  options = placement.candidates(im.size[0], im.size[1], fitMode, minSize, maxCrop)
+  if len(options) > 1:
+    options = rank(path, im, options, blank, invertColormap)
+  else:
+    print("{}: {}x{}, placed at {}".format(path, im.size[0], im.size[1], placement.describe(options[0])))
+  gray = placement.render(im, options[0], blank)
+  return gray, dither.MODES[mode](gray)
+
+# Placements shown at most when ranking them
+RANKED_SHOWN = 10
+
+# Placements from the fastest to print as a patch (then the largest and least cropped). They
+# are dithered with PIL's quick Floyd-Steinberg to be timed, whatever the mode.
+def rank(path, im, options, blank, invertColormap):
+  timed = []
+  for p in options:
+    bits = dither.floyd_steinberg(placement.render(im, p, blank))
+    timed.append((imagelib.patch_seconds(~bits if invertColormap else bits), p))
+  timed.sort(key=lambda t: (t[0], -t[1].size, t[1].crop))
+
+  print("{}: {}x{}, {} placements within the limits".format(path, im.size[0], im.size[1], len(timed)))
+  for i, (seconds, p) in enumerate(timed[:RANKED_SHOWN]):
+    print("  {}  {:>5.1f} min as a patch{}".format(placement.describe(p), seconds / 60, "  <- picked" if i == 0 else ""))
+  if len(timed) > RANKED_SHOWN:
+    print("  ... and {} slower ones".format(len(timed) - RANKED_SHOWN))
+  return [p for _, p in timed]
+
+# Simplify the image until its inked pixels print as a patch within the budget (inverted first
+# when the printed pixels are the blank ones)
+def fit(path, bits, maxMinutes, invertColormap):
+  printed = ~bits if invertColormap else bits
+  simplified, removed = simplify.fit(printed, maxMinutes * 60)
+  minutes = imagelib.patch_seconds(simplified) / 60
+  print("{}: {} pixels removed, prints in {:.1f} min as a patch".format(path, removed, minutes))
+  if minutes > maxMinutes:
+    print("WARNING: {} does not fit in {:g} min, nothing left to remove cheaply".format(path, maxMinutes))
+  return ~simplified if invertColormap else simplified
+
+def decibels(quality):
+  return "exact" if quality == float("inf") else "{:.1f} dB".format(quality)
+
+# Search budget of the annealed plan the estimates time, in seconds. Its routes come out longer
+# than with the 10 s of plan2c.py, up to a fifth on line art, but on tones it ranks the
+# dithering modes the same.
+ESTIMATE_SECONDS = 1.0
+
+# Time of the annealed plan of the image (see plan2c.py). It crosses each run of ink in one
+# stroke and orders the runs, so unlike the patch it gets faster with fewer, longer runs.
+def anneal_seconds(bits):
+  return plan2c.seconds(plan2c.annealed(bits, ESTIMATE_SECONDS))
+
+# Print time with the serpentine, as a patch of the inked pixels on a clear canvas, and as an
+# annealed plan
+def estimate(bits):
+  return "about {:.1f} min to print ({:.1f} min as a patch, {:.1f} min as an annealed plan)".format(
+    imagelib.serpentine_seconds() / 60, imagelib.patch_seconds(bits) / 60, anneal_seconds(bits) / 60)
+
+# Print time and quality of every dithering mode
+def compare(images):
+  print("{:<18} {:<10} {:>7} {:>8} {:>9} {:>9}".format("image", "dither", "ink", "quality", "patch", "anneal"))
+  for path, gray, _ in images:
+    for mode in dither.MODES:
+      bits = dither.MODES[mode](gray)
+      print("{:<18} {:<10} {:>6.1f}% {:>8} {:>5.1f} min {:>5.1f} min".format(imagelib.image_name(path), mode,
+        100.0 * bits.mean(), decibels(dither.quality(gray, bits)), imagelib.patch_seconds(bits) / 60,
+        anneal_seconds(bits) / 60))
+  print("The serpentine takes about {:.1f} min whatever the image".format(imagelib.serpentine_seconds() / 60))
+
+def usage():
+  print("To convert to image.c: png2c.py <yourImage.png>")
+  print("To convert to an inverted image.c: png2c.py -i <yourImage.png>")
+  print("To convert to another file: png2c.py -o post.c <yourImage.png>")
+  print("To convert many images to <name>.c in a directory: png2c.py -o posts/ <one.png> <two.png>...")
+  print("To pick a dithering mode: png2c.py -d atkinson <yourImage.png> (fs, threshold, bayer, atkinson or runs)")
+  print("To compare the print time and quality of the dithering modes: png2c.py -c <yourImage.png>")
+  print("To simplify the image until it prints within a time: png2c.py --max-minutes 10 [-p] <yourImage.png>")
+  print("To place an image of any size on the canvas: png2c.py --fit letterbox|crop <yourImage.png>")
+  print("To pick the placement that prints the fastest: png2c.py --fit auto [--min-size 80] [--max-crop 10] <yourImage.png>")
+  print("  (--min-size is the smallest size tried in % of the one that fits, --max-crop the most % of the image cut off)")
+  print("To preview bilevel image: png2c.py -p <yourImage.png>")
+  print("To save bilevel image: png2c.py -s <yourImage.png>")
+
+if __name__ == "__main__":
+  if len(sys.argv[1:]) == 0:
+    usage()
+    sys.exit()
+  else:
+    main(sys.argv[1:])
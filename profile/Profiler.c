@@ -0,0 +1,375 @@
+/** \file
+ *
+ *  Cycle profile of the real AVR build under simavr. There is no USB host in simavr, so the
+ *  profiler stands in for one through the ioctls of simavr's USB module: it powers the bus,
+ *  resets it once the firmware attaches, sets the address and the configuration like a host
+ *  enumerating the controller, then reads the IN endpoint every POLLING_MS.
+ *
+ *  Every instruction is stepped, and calls to the profiled functions are timed from their
+ *  entry address until the stack pointer climbs back above its value at entry.
+ */
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <simavr/avr_usb.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/sim_irq.h>
+#include <simavr/sim_vcd_file.h>
+
+// Stack pointer (data space addresses, the same on all the supported parts)
+#define REG_SPL     0x5D
+#define REG_SPH     0x5E
+
+#define DATA_OFFSET 0x800000 // avr-nm shows RAM addresses with this offset
+
+// Same as in Descriptors.h
+#ifndef POLLING_MS
+#define POLLING_MS 8
+#endif
+#define JOYSTICK_IN_EP  1
+#define JOYSTICK_EPSIZE 64
+
+// Without a report for this long, enumeration included, the profile gives up
+#define STALL_MS 2000
+
+// Steps of the stand-in host, each one retried until the firmware answers it
+typedef enum {
+	HOST_POWER,
+	HOST_ATTACH,
+	HOST_SET_ADDRESS,
+	HOST_ADDRESS_STATUS,
+	HOST_SET_CONFIGURATION,
+	HOST_CONFIGURATION_STATUS,
+	HOST_POLL,
+} Host_t;
+
+static const char* host_names[] = {"power", "attach", "set address", "set address status",
+	"set configuration", "set configuration status", "poll"};
+
+// Standard requests: bmRequestType, bRequest, wValue, wIndex, wLength
+static uint8_t set_address[8] = {0x00, 0x05, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00};
+static uint8_t set_configuration[8] = {0x00, 0x09, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+enum { FN_GET_NEXT_REPORT, FN_HID_TASK, FN_USB_TASK, FN_COUNT };
+static const char* fn_names[FN_COUNT] = {"GetNextReport", "HID_Task", "USB_USBTask"};
+
+typedef struct {
+	uint32_t Address;
+	uint64_t Calls;
+	uint64_t Total;
+	uint64_t Max;
+} Function_t;
+
+typedef struct {
+	int      Function;
+	uint64_t Start;
+	uint16_t SP;
+	bool     Reported; // HID_Task only: a report was prepared during this call
+} Frame_t;
+
+static Function_t functions[FN_COUNT];
+static Frame_t stack[16];
+static int depth = 0;
+static bool attached = false;
+
+static void Attach_Hook(struct avr_irq_t* irq, uint32_t value, void* param)
+{
+	attached = value != 0;
+}
+
+// Sends a setup packet on the control endpoint
+static void Host_Setup(avr_t* avr, uint8_t* request)
+{
+	struct avr_io_usb packet = {.pipe = 0, .sz = 8, .buf = request};
+	avr_ioctl(avr, AVR_IOCTL_USB_SETUP, &packet);
+}
+
+// Reads an endpoint, false while the firmware has nothing to send (NAK) or stalls it
+static bool Host_Read(avr_t* avr, uint8_t pipe)
+{
+	static uint8_t buffer[JOYSTICK_EPSIZE];
+	struct avr_io_usb packet = {.pipe = pipe, .sz = sizeof(buffer), .buf = buffer};
+	return avr_ioctl(avr, AVR_IOCTL_USB_READ, &packet) == 0;
+}
+
+// Takes the next step of the host once the firmware is ready for it
+static Host_t Host_Step(avr_t* avr, Host_t host)
+{
+	switch (host)
+	{
+	case HOST_POWER:
+		avr_ioctl(avr, AVR_IOCTL_USB_VBUS, (void*)1);
+		return HOST_ATTACH;
+	case HOST_ATTACH:
+		if (!attached)
+			return host;
+		avr_ioctl(avr, AVR_IOCTL_USB_RESET, NULL);
+		return HOST_SET_ADDRESS;
+	case HOST_SET_ADDRESS:
+		Host_Setup(avr, set_address);
+		return HOST_ADDRESS_STATUS;
+	case HOST_ADDRESS_STATUS:
+		return Host_Read(avr, 0) ? HOST_SET_CONFIGURATION : host;
+	case HOST_SET_CONFIGURATION:
+		Host_Setup(avr, set_configuration);
+		return HOST_CONFIGURATION_STATUS;
+	case HOST_CONFIGURATION_STATUS:
+		return Host_Read(avr, 0) ? HOST_POLL : host;
+	default:
+		return host;
+	}
+}
+
+static void Usage(void)
+{
+	printf("Usage: profiler -m mcu -f function=0xaddr... [-F hz] [-n reports] [-o name] firmware.elf\n");
+	printf("  -m  MCU name, as in the makefile, simavr must have a core for it (see MCU in profile/makefile)\n");
+	printf("  -f  entry address of GetNextReport, HID_Task and USB_USBTask (from avr-nm)\n");
+	printf("  -F  clock in Hz, F_CPU of the build (default 16000000)\n");
+	printf("  -n  reports to profile (default 5000)\n");
+	printf("  -v  reports to keep in the VCD trace (default 200)\n");
+	printf("  -o  output base name for the .csv and .vcd traces (default profile)\n");
+	printf("  -d  0xaddr:size of a variable to save from SRAM at the end to <name>.timing (from avr-nm -S)\n");
+}
+
+int main(int argc, char* argv[])
+{
+	const char* mcu = NULL;
+	const char* out = "profile";
+	uint32_t frequency = 16000000;
+	uint64_t max_reports = 5000;
+	uint64_t vcd_reports = 200;
+	uint32_t dump_address = 0;
+	uint32_t dump_size = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:f:n:v:o:F:d:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 'm':
+			mcu = optarg;
+			break;
+		case 'f':
+			for (int i = 0; i < FN_COUNT; i++)
+			{
+				size_t length = strlen(fn_names[i]);
+				if (strncmp(optarg, fn_names[i], length) == 0 && optarg[length] == '=')
+					functions[i].Address = strtoul(optarg + length + 1, NULL, 0);
+			}
+			break;
+		case 'n':
+			max_reports = strtoull(optarg, NULL, 0);
+			break;
+		case 'v':
+			vcd_reports = strtoull(optarg, NULL, 0);
+			break;
+		case 'o':
+			out = optarg;
+			break;
+		case 'd':
+		{
+			char* end;
+			dump_address = strtoul(optarg, &end, 0) - DATA_OFFSET;
+			dump_size = *end == ':' ? strtoul(end + 1, NULL, 0) : 0;
+			break;
+		}
+		case 'F':
+			frequency = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			Usage();
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (optind >= argc || mcu == NULL)
+	{
+		Usage();
+		return 1;
+	}
+	for (int i = 0; i < FN_COUNT; i++)
+	{
+		if (functions[i].Address == 0)
+		{
+			fprintf(stderr, "No address for %s (was it inlined? build with -fno-inline-functions-called-once)\n", fn_names[i]);
+			return 1;
+		}
+	}
+
+	elf_firmware_t firmware;
+	memset(&firmware, 0, sizeof(firmware));
+	if (elf_read_firmware(argv[optind], &firmware) != 0)
+	{
+		fprintf(stderr, "Could not read %s\n", argv[optind]);
+		return 1;
+	}
+	strncpy(firmware.mmcu, mcu, sizeof(firmware.mmcu) - 1);
+	firmware.frequency = frequency;
+
+	avr_t* avr = avr_make_mcu_by_name(firmware.mmcu);
+	if (avr == NULL)
+	{
+		fprintf(stderr, "%s is not supported by this simavr, profile the at90usb162 build instead\n", mcu);
+		return 1;
+	}
+	avr_init(avr);
+	avr_load_firmware(avr, &firmware);
+	avr_irq_t* attach = avr_io_getirq(avr, AVR_IOCTL_USB_GETIRQ(), USB_IRQ_ATTACH);
+	if (attach == NULL)
+	{
+		fprintf(stderr, "This simavr has no USB module for %s\n", mcu);
+		return 1;
+	}
+	avr_irq_register_notify(attach, Attach_Hook, NULL);
+
+	// One signal per profiled function, high while it runs
+	char vcd_path[256];
+	char csv_path[256];
+	avr_vcd_t vcd;
+	avr_irq_t* irq = avr_alloc_irq(&avr->irq_pool, 0, FN_COUNT, fn_names);
+	snprintf(vcd_path, sizeof(vcd_path), "%s.vcd", out);
+	snprintf(csv_path, sizeof(csv_path), "%s.csv", out);
+	avr_vcd_init(avr, vcd_path, &vcd, 1);
+	for (int i = 0; i < FN_COUNT; i++)
+		avr_vcd_add_signal(&vcd, irq + i, 1, fn_names[i]);
+	avr_vcd_start(&vcd);
+
+	FILE* csv = fopen(csv_path, "w");
+	if (csv == NULL)
+	{
+		fprintf(stderr, "Could not write %s\n", csv_path);
+		return 1;
+	}
+	fprintf(csv, "report,cycle,GetNextReport,HID_Task,USB_USBTask_total,USB_USBTask_max\n");
+
+	const uint64_t poll_cycles = (uint64_t)frequency * POLLING_MS / 1000;
+	const uint64_t stall_cycles = (uint64_t)frequency * STALL_MS / 1000;
+	uint64_t next_poll = 0;
+	uint64_t last_report = 0;
+	Host_t host = HOST_POWER;
+	bool stalled = false;
+	uint64_t reports = 0;
+	uint64_t report_cycles = 0;
+	uint64_t usb_total = 0;
+	uint64_t usb_max = 0;
+	int state = cpu_Running;
+
+	while (reports < max_reports && state != cpu_Done && state != cpu_Crashed)
+	{
+		state = avr_run(avr);
+
+		// Stand in for the USB host: enumerate, then take the report every poll
+		if (host != HOST_POLL)
+			host = Host_Step(avr, host);
+		else if (avr->cycle >= next_poll)
+		{
+			Host_Read(avr, JOYSTICK_IN_EP);
+			next_poll = avr->cycle + poll_cycles;
+		}
+		if (avr->cycle - last_report > stall_cycles)
+		{
+			stalled = true;
+			break;
+		}
+
+		// Returns: the stack pointer is back above where it was at the entry of the call
+		uint16_t sp = avr->data[REG_SPL] | avr->data[REG_SPH] << 8;
+		while (depth > 0 && sp > stack[depth - 1].SP)
+		{
+			Frame_t* frame = &stack[--depth];
+			Function_t* function = &functions[frame->Function];
+			uint64_t cycles = avr->cycle - frame->Start;
+
+			if (reports < vcd_reports)
+				avr_raise_irq(irq + frame->Function, 0);
+
+			if (frame->Function == FN_USB_TASK)
+			{
+				usb_total += cycles;
+				if (cycles > usb_max)
+					usb_max = cycles;
+			}
+			else if (frame->Function == FN_GET_NEXT_REPORT)
+			{
+				report_cycles = cycles;
+				if (depth > 0 && stack[depth - 1].Function == FN_HID_TASK)
+					stack[depth - 1].Reported = true;
+			}
+			else if (!frame->Reported)
+				continue; // HID_Task calls without a report only count towards nothing
+
+			function->Calls++;
+			function->Total += cycles;
+			if (cycles > function->Max)
+				function->Max = cycles;
+
+			if (frame->Function == FN_HID_TASK)
+			{
+				fprintf(csv, "%llu,%llu,%llu,%llu,%llu,%llu\n", (unsigned long long)reports,
+					(unsigned long long)frame->Start, (unsigned long long)report_cycles,
+					(unsigned long long)cycles, (unsigned long long)usb_total, (unsigned long long)usb_max);
+				usb_total = 0;
+				usb_max = 0;
+				last_report = avr->cycle;
+				reports++;
+			}
+		}
+
+		// Calls: the program counter is on a profiled entry address
+		for (int i = 0; i < FN_COUNT; i++)
+		{
+			if (avr->pc == functions[i].Address && depth < 16
+				&& (depth == 0 || stack[depth - 1].Function != i || stack[depth - 1].SP != sp))
+			{
+				stack[depth++] = (Frame_t){.Function = i, .Start = avr->cycle, .SP = sp, .Reported = false};
+				if (reports < vcd_reports)
+					avr_raise_irq(irq + i, 1);
+			}
+		}
+	}
+
+	avr_vcd_stop(&vcd);
+	avr_vcd_close(&vcd);
+	fclose(csv);
+
+	// A variable the firmware keeps in SRAM, like the timing trace
+	if (dump_size > 0)
+	{
+		char dump_path[256];
+		snprintf(dump_path, sizeof(dump_path), "%s.timing", out);
+		FILE* dump = fopen(dump_path, "wb");
+		if (dump == NULL || dump_address + dump_size > avr->ramend + 1
+			|| fwrite(avr->data + dump_address, 1, dump_size, dump) != dump_size)
+			fprintf(stderr, "Could not save %s\n", dump_path);
+		if (dump != NULL)
+			fclose(dump);
+	}
+
+	if (state == cpu_Crashed)
+		fprintf(stderr, "The firmware crashed after %llu reports\n", (unsigned long long)reports);
+	if (stalled)
+		fprintf(stderr, "No report for %d ms after %llu reports, the host was at: %s\n", STALL_MS,
+			(unsigned long long)reports, host_names[host]);
+
+	printf("%s @ %u MHz, %llu reports, %llu cycles between polls\n", mcu, frequency / 1000000,
+		(unsigned long long)reports, (unsigned long long)poll_cycles);
+	printf("%-16s %10s %10s %10s %14s\n", "function", "calls", "mean", "worst", "worst/poll");
+	for (int i = 0; i < FN_COUNT; i++)
+	{
+		Function_t* function = &functions[i];
+		printf("%-16s %10llu %10llu %10llu %13.2f%%\n", fn_names[i], (unsigned long long)function->Calls,
+			(unsigned long long)(function->Calls ? function->Total / function->Calls : 0),
+			(unsigned long long)function->Max, 100.0 * function->Max / poll_cycles);
+	}
+	printf("Traces saved to %s and %s\n", csv_path, vcd_path);
+
+	return state == cpu_Crashed || stalled ? 1 : 0;
+}
@@ -0,0 +1,5 @@
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+const uint8_t queue_length = 0;
+const uint8_t queue_data[] PROGMEM = {0x0};
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+
+# Queue builder: saves several images to print in one session, the first one to image.c and the
+# others to queue.c, which the firmware prints one after the other, saving each post in between
+# (see "Queue mode" in Joystick.c).
+
+import sys, getopt
+import imagelib
+
+# Bytes per image, the same as image_data in image.c
+IMAGE_SIZE = imagelib.WIDTH * imagelib.HEIGHT // 8 + 1
+# pgm_read_byte() only reaches the first 64 KB of flash, where the images, the plan and the
+# patch all go, next to the firmware code
+MAX_QUEUED = 10
+# Time between two posts: the wait, the save sequence and homing the cursor, with the defaults
+# of Joystick.c
+SECONDS_BETWEEN_POSTS = 5.0 + 9.8 + 4.0
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hci")
+  invertColormap = False
+  image = "image.c"
+  output = "queue.c"
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-i':
+      invertColormap = True
+    elif opt == '-c':
+      write_queue([], output)
+      print("Empty queue saved to {}, the printer stops after image.c".format(output))
+      return
+
+  if not args:
+    usage()
+    sys.exit(1)
+  if len(args) - 1 > MAX_QUEUED:
+    print("ERROR: {} images don't fit in flash, queue at most {} after the first".format(len(args), MAX_QUEUED))
+    sys.exit(1)
+
+  try:
+    images = [imagelib.load(path, invertColormap) for path in args]
+  except (ValueError, OSError) as e:
+    print("ERROR: {}".format(e))
+    sys.exit(1)
+
+  imagelib.write_image_c(images[0], image)
+  write_queue(images[1:], output)
+  print("{} saved to {}, {} more queued in {} ({:.1f} KB)".format(
+    args[0], image, len(images) - 1, output, (len(images) - 1) * IMAGE_SIZE / 1024))
+  seconds = len(images) * imagelib.serpentine_seconds() + (len(images) - 1) * SECONDS_BETWEEN_POSTS
+  print("About {:.0f} min for {} posts, check it fits with make budget".format(seconds / 60, len(images)))
+
+# Each image is packed as in image.c, trailing byte included, so they all have the same size
+def write_queue(images, path):
+  data = []
+  for bits in images:
+    data += imagelib.pack(bits).tolist() + [0]
+  with open(path, 'w') as f:
+    f.write(imagelib.C_HEADER)
+    f.write("const uint8_t queue_length = {};\n".format(len(images)))
+    f.write("const uint8_t queue_data[] PROGMEM = {")
+    f.write("".join(map("{:#x}, ".format, data)) + "0x0};\n")
+
+def usage():
+  print("To print several images in a row: queue2c.py <first.png> <second.png> ...")
+  print("  the first one goes to image.c, the others to queue.c, the printer saves each post before the next")
+  print("To use an inverted colormap: queue2c.py -i <first.png> <second.png> ...")
+  print("To go back to printing image.c alone: queue2c.py -c")
+  print("Images can also be .data files with one byte per pixel")
+
+if __name__ == "__main__":
+  if len(sys.argv[1:]) == 0:
+    usage()
+    sys.exit()
+  else:
+    main(sys.argv[1:])
@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+
+# Corrections from a screenshot of the finished post: finds the canvas in the screenshot, reads
+# it back as 1bpp, compares it with the image that was printed, and saves the smallest fix as
+# correction lines, correction rectangles (Correction.h) or a patch (patch.c).
+
+import sys, getopt
+import numpy as np
+from PIL import Image
+import imagelib, patch2c
+
+WIDTH = imagelib.WIDTH
+HEIGHT = imagelib.HEIGHT
+
+# Canvas sizes tried when looking for it, from one screen pixel per canvas pixel up, each this
+# much larger than the previous
+SCALE_STEP = 1.02
+# Smallest move of the canvas, in screen pixels, tried when settling where it is
+REFINE_STEP = 1 / 8
+# How much each canvas pixel is sharpened against its neighbours when reading it
+SHARPEN = 1.0
+# Rows of a rectangle may have different spans, as long as it adds no more than this many pixels
+RECT_SLACK = 16
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hir:m:o:d:")
+  invertColormap = False
+  bounds = None
+  mode = None
+  output = None
+  canvasData = None
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-i':
+      invertColormap = True
+    elif opt == '-r':
+      bounds = [float(v) for v in arg.split(",")]
+    elif opt == '-m':
+      mode = arg
+    elif opt == '-o':
+      output = arg
+    elif opt == '-d':
+      canvasData = arg
+
+  if mode not in (None, "rows", "rects", "patch"):
+    print("ERROR: unknown plan {}, pick one of rows, rects or patch".format(mode))
+    sys.exit(1)
+
+  try:
+    screen = np.asarray(Image.open(args[0]).convert("L"), dtype=float) / 255
+    target = imagelib.load(args[1] if len(args) > 1 else "image.c", invertColormap)
+  except (ValueError, OSError) as e:
+    print("ERROR: {}".format(e))
+    sys.exit(1)
+
+  if bounds:
+    x0, y0, x1, y1 = bounds
+    placement = (x0, y0, (x1 - x0) / WIDTH)
+  else:
+    placement = register(screen, target)
+  canvas, agreement, _ = read_canvas(screen, target, *placement)
+  print("Canvas found at ({:.0f}, {:.0f}), {:.0f}x{:.0f} px, {:.1f}% of it matches the image".format(
+    placement[0], placement[1], WIDTH * placement[2], HEIGHT * placement[2], 100 * agreement))
+  if agreement < 0.9:
+    print("WARNING: that is not much, check the canvas bounds with -d canvas.data or give them with -r")
+  if canvasData:
+    canvas.astype(np.uint8).tofile(canvasData)
+    print("Canvas saved to {}".format(canvasData))
+
+  wrong = canvas != target
+  if not wrong.any():
+    print("No wrong pixels, nothing to correct")
+    return
+
+  plans = {
+    "rows": rows_plan(wrong),
+    "rects": rects_plan(wrong),
+    "patch": patch_plan(wrong, target),
+  }
+  print("{} wrong pixels in {} rows".format(int(wrong.sum()), int(wrong.any(axis=1).sum())))
+  for name, (plan, seconds) in plans.items():
+    print("  {:<6} {:>4} entries, about {:.1f} min".format(name, len(plan), seconds / 60))
+
+  if mode is None:
+    mode = min(plans, key=lambda name: plans[name][1])
+  plan = plans[mode][0]
+  if mode == "patch":
+    patch2c.write_patch(plan)
+    print("Patch saved to patch.c")
+  else:
+    out = output or "Correction.h"
+    write_header(out, args[0], plan if mode == "rows" else [], plan if mode == "rects" else [])
+    print("Correction {} saved to {}, build with -DUSE_CORRECTION_HEADER".format(mode, out))
+
+# Find the canvas: the placement (x0, y0, screen pixels per canvas pixel) where the screenshot
+# looks most like the image, by normalized cross-correlation over a range of canvas sizes.
+# Wrong pixels are few, so the printed post still matches the image best where it really is.
+def register(screen, target):
+  h, w = screen.shape
+  dark = 1 - screen
+  spectrum = np.fft.rfft2(dark)
+  # Sums over every window, to normalize by the contrast of the screenshot under it
+  sat = np.pad(dark, ((1, 0), (1, 0))).cumsum(0).cumsum(1)
+  sat2 = np.pad(dark ** 2, ((1, 0), (1, 0))).cumsum(0).cumsum(1)
+
+  best = (-np.inf, 0, 0, 1.0)
+  scale = 1.0
+  while WIDTH * scale <= w and HEIGHT * scale <= h:
+    tw, th = int(round(WIDTH * scale)), int(round(HEIGHT * scale))
+    t = np.asarray(Image.fromarray(target.astype(np.uint8) * 255).resize((tw, th), Image.NEAREST), dtype=float) / 255
+    t -= t.mean()
+    norm = np.sqrt((t ** 2).sum())
+    if norm > 0:
+      corr = np.fft.irfft2(spectrum * np.conj(np.fft.rfft2(t, dark.shape)), dark.shape)
+      corr = corr[:h - th + 1, :w - tw + 1]
+      box = lambda a: a[th:, tw:] - a[:-th, tw:] - a[th:, :-tw] + a[:-th, :-tw]
+      s1, s2 = box(sat), box(sat2)
+      std = np.sqrt(np.maximum(s2 - s1 ** 2 / (tw * th), 1e-9))
+      ncc = corr / (norm * std)
+      y, x = np.unravel_index(np.argmax(ncc), ncc.shape)
+      if ncc[y, x] > best[0]:
+        best = (ncc[y, x], x, y, tw / WIDTH)
+    scale *= SCALE_STEP
+
+  # The correlation is only as fine as the resized image, settle the placement by reading the
+  # canvas: move its left, top and right edges while it reads better, then halve the step,
+  # until the estimate stops moving. Any placement within a cell matches the image as well, the
+  # contrast of the reading breaks the tie as it is highest in the middle of the cells.
+  _, x0, y0, scale = best
+  edges = [x0, y0, x0 + WIDTH * scale]
+  fit = lambda e: read_canvas(screen, target, e[0], e[1], (e[2] - e[0]) / WIDTH)[2]
+  score = fit(edges)
+  step = 1.0
+  while step >= REFINE_STEP:
+    moved = False
+    for i in range(3):
+      for move in (-step, step):
+        candidate = list(edges)
+        candidate[i] += move
+        candidate_score = fit(candidate)
+        if candidate_score > score:
+          edges, score, moved = candidate, candidate_score, True
+    if not moved:
+      step /= 2
+  return edges[0], edges[1], (edges[2] - edges[0]) / WIDTH
+
+# Read the canvas at a placement: each pixel is sampled at the centre of its cell, between the
+# screen pixels around it so the reading changes smoothly with the placement, then sharpened against its 4 neighbours to undo the blur of the screen capture (single pixels lose
+# a lot of contrast), and inked if it is nearer to the ink than to the blank canvas. Returns the
+# canvas, the share of it that matches the image and how much lighter blank reads than ink.
+def read_canvas(screen, target, x0, y0, scale):
+  h, w = screen.shape
+  # Centres of the cells, counting from the centre of the first screen pixel
+  fx = np.clip(x0 + (np.arange(WIDTH) + 0.5) * scale - 0.5, 0, w - 1)
+  fy = np.clip(y0 + (np.arange(HEIGHT) + 0.5) * scale - 0.5, 0, h - 1)
+  xs, ys = np.minimum(fx.astype(int), w - 2), np.minimum(fy.astype(int), h - 2)
+  wx, wy = fx - xs, (fy - ys)[:, None]
+  level = ((1 - wy) * ((1 - wx) * screen[np.ix_(ys, xs)] + wx * screen[np.ix_(ys, xs + 1)])
+           + wy * ((1 - wx) * screen[np.ix_(ys + 1, xs)] + wx * screen[np.ix_(ys + 1, xs + 1)]))
+  p = np.pad(level, 1, mode='edge')
+  level = level + SHARPEN * (level - (p[:-2, 1:-1] + p[2:, 1:-1] + p[1:-1, :-2] + p[1:-1, 2:]) / 4)
+
+  ink = np.median(level[target]) if target.any() else 0.0
+  blank = np.median(level[~target]) if not target.all() else 1.0
+  canvas = np.abs(level - ink) < np.abs(level - blank)
+  contrast = level[~target].mean() - level[target].mean() if target.any() and not target.all() else 0.0
+  return canvas, float((canvas == target).mean()), float(contrast)
+
+# Steps of a correction build: every row is crossed, the cursor goes to the nearest end of each
+# span, erases it in one pass and re-inks it coming back (the default two pass correction)
+def correction_seconds(spans):
+  steps = HEIGHT
+  x = 0
+  for y in range(HEIGHT):
+    if y in spans:
+      x0, x1 = spans[y]
+      start = x0 if x - x0 <= x1 - x else x1
+      steps += abs(x - start) + 2 * (x1 - x0) + 1
+      x = start
+  return imagelib.SYNC_SECONDS + steps * imagelib.SECONDS_PER_STEP
+
+def rows_plan(wrong):
+  rows = [int(y) for y in np.nonzero(wrong.any(axis=1))[0]]
+  return rows, correction_seconds({y: (0, WIDTH - 1) for y in rows})
+
+# One rectangle per run of rows, grown while that adds at most RECT_SLACK pixels to correct
+def rects_plan(wrong):
+  rects = []
+  for y in np.nonzero(wrong.any(axis=1))[0]:
+    xs = np.nonzero(wrong[y])[0]
+    x0, x1 = int(xs[0]), int(xs[-1])
+    if rects and rects[-1][3] == y - 1:
+      rx0, rx1, ry0, ry1 = rects[-1]
+      grown = (max(rx1, x1) - min(rx0, x0) + 1) * (y - ry0 + 1)
+      apart = (rx1 - rx0 + 1) * (ry1 - ry0 + 1) + (x1 - x0 + 1)
+      if grown - apart <= RECT_SLACK:
+        rects[-1] = (min(rx0, x0), max(rx1, x1), ry0, int(y))
+        continue
+    rects.append((x0, x1, int(y), int(y)))
+
+  spans = {}
+  for x0, x1, y0, y1 in rects:
+    for y in range(y0, y1 + 1):
+      spans[y] = (x0, x1)
+  return rects, correction_seconds(spans)
+
+def patch_plan(wrong, target):
+  entries = [(int(x), int(y), bool(target[y, x])) for y, x in zip(*np.nonzero(wrong))]
+  entries, steps = patch2c.route(entries)
+  return entries, imagelib.SYNC_SECONDS + steps * imagelib.SECONDS_PER_STEP
+
+def write_header(path, screenshot, rows, rects):
+  with open(path, 'w') as f:
+    f.write("/** \\file\n *\n")
+    f.write(" *  Corrections found by screen2c.py in {}.\n".format(screenshot))
+    f.write(" *  Generated file, build with -DUSE_CORRECTION_HEADER to use it.\n */\n\n")
+    f.write("const int linesToCorrect[] = {{{}}};\n".format(", ".join(str(y) for y in rows)))
+    f.write("const CorrectionRect_t rectsToCorrect[] = {{{}}};\n".format(", ".join(
+      "{{.X0 = {}, .X1 = {}, .Y0 = {}, .Y1 = {}}}".format(*r) for r in rects)))
+
+def usage():
+  print("To correct the post in a screenshot, printed from image.c: screen2c.py <screenshot.png>")
+  print("To compare with another image: screen2c.py <screenshot.png> <yourImage.png>")
+  print("To use an inverted colormap for the image: screen2c.py -i <screenshot.png> <yourImage.png>")
+  print("To pick the plan instead of the fastest one: screen2c.py -m rows|rects|patch <screenshot.png>")
+  print("To give the canvas bounds in the screenshot: screen2c.py -r x0,y0,x1,y1 <screenshot.png>")
+  print("To save the canvas read from the screenshot (one byte per pixel): screen2c.py -d canvas.data <screenshot.png>")
+  print("To save the correction header elsewhere: screen2c.py -o Correction.h <screenshot.png>")
+
+if __name__ == "__main__":
+  if len(sys.argv[1:]) == 0:
+    usage()
+    sys.exit()
+  else:
+    main(sys.argv[1:])
@@ -0,0 +1,5 @@
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+const uint16_t script_length = 0;
+const uint8_t script_data[] PROGMEM = {0xff, 0xff, 0x0};
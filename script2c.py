@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+
+# Script assembler: turns a printer script (see scripts/) into script.c, the bytecode the
+# firmware runs when built with -DSCRIPT_VM (see ScriptVM.h for the ops).
+#
+# One op per line, ";" starts a comment:
+#   label:                     a place to jump to
+#   .resync label              where to go when the connection drops (see resume)
+#   .include file              the lines of another script, relative to this one
+#   report BUTTONS HAT LX LY N send this report N times
+#   wait N                     N neutral reports
+#   press BUTTONS [N]          hold the buttons for N reports (1 by default)
+#   stick LX LY N [BUTTONS]    hold the left stick, and the buttons, for N reports
+#   setxy X Y                  the cursor is at (X, Y), after pushing it into a corner
+#   loop N ... next            run the ops in between N times, loops nest
+#   jump label                 to a label in the same loop (or outside of any, like .resync)
+#   move DIR N                 move N pixels without inking
+#   step DIR N                 move N pixels, inking the black ones
+#   ink                        ink the pixel under the cursor if it is black
+#   span                       go to the nearest end of the black pixels of the row, cross them inking
+#   fix [onepass]              correct the span of the row from the correction lists of Joystick.c
+#   plan                       play back plan.c
+#   resume                     at the end of the resync handler: walk back and carry on
+#   end
+# BUTTONS are names joined with "+" (A+B, LCLICK) or "-" for none, HAT and DIR are names
+# (right, left, down, up, center...), sticks go from 0 to 255 or min, center, max. Counts
+# can be given in ms ("2000ms"), converted as the firmware's ms_2_count() does.
+
+import sys, os, getopt
+import imagelib
+
+BUTTONS = {"Y": 0x01, "B": 0x02, "A": 0x04, "X": 0x08, "L": 0x10, "R": 0x20, "ZL": 0x40, "ZR": 0x80,
+           "MINUS": 0x100, "PLUS": 0x200, "LCLICK": 0x400, "RCLICK": 0x800, "HOME": 0x1000, "CAPTURE": 0x2000}
+HATS = {"top": 0, "up": 0, "top-right": 1, "right": 2, "bottom-right": 3, "bottom": 4, "down": 4,
+        "bottom-left": 5, "left": 6, "top-left": 7, "center": 8}
+STICK = {"min": 0, "center": 128, "max": 255}
+# Directions of the move ops, as in planHatTable (Joystick.c)
+DIRECTIONS = {"right": 0, "left": 1, "down": 2, "up": 3}
+
+# Ops, the same as SCRIPT_* in ScriptVM.h
+END, REPORT, SETXY, LOOP, NEXT, JUMP, MOVE, STEP, INK, SPAN, FIX, PLAN, RESUME = range(13)
+NO_HANDLER = 0xFFFF
+FIX_TWO_PASS, FIX_ONE_PASS = 0, 1
+# Nested loops the firmware keeps (SCRIPT_LOOP_DEPTH in ScriptVM.h)
+LOOP_DEPTH = 4
+# Reports sent for each report of the script (ECHOES in Joystick.c)
+ECHOES = 2
+
+class ScriptError(Exception):
+  pass
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hce:o:")
+  output = "script.c"
+  echoes = ECHOES
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-e':
+      echoes = int(arg)
+    elif opt == '-o':
+      output = arg
+    elif opt == '-c':
+      write_script(bytes([NO_HANDLER & 0xFF, NO_HANDLER >> 8]), output, empty=True)
+      print("Empty script saved to {}, build without -DSCRIPT_VM to go back to normal printing".format(output))
+      return
+
+  try:
+    code = assemble(args[0], echoes)
+  except (ScriptError, OSError) as e:
+    print("ERROR: {}".format(e))
+    sys.exit(1)
+
+  write_script(code, output)
+  print("{} assembled to {}: {} bytes, build with -DSCRIPT_VM to run it".format(args[0], output, len(code)))
+
+# Lines of a script with the included ones, as (file, line number, text)
+def read_lines(path, seen=()):
+  if path in seen:
+    raise ScriptError("{} includes itself".format(path))
+  lines = []
+  for number, text in enumerate(open(path), 1):
+    text = text.split(";", 1)[0].strip()
+    if text.startswith(".include"):
+      included = os.path.join(os.path.dirname(path), text.split(None, 1)[1])
+      lines += read_lines(included, seen + (path,))
+    elif text:
+      lines.append((path, number, text))
+  return lines
+
+def number(token, echoes, low=0, high=0xFFFF):
+  if token.endswith("ms"):
+    value = int(token[:-2]) // echoes // 8
+  else:
+    value = int(token, 0)
+  if not low <= value <= high:
+    raise ValueError("{} is out of {}-{}".format(token, low, high))
+  return value
+
+def buttons(token):
+  if token == "-":
+    return 0
+  return sum(BUTTONS[name.upper()] for name in token.split("+"))
+
+def stick(token):
+  return STICK[token] if token in STICK else number(token, ECHOES, 0, 255)
+
+def word(value):
+  return [value & 0xFF, value >> 8]
+
+# Assemble a script into its bytecode, header included
+def assemble(path, echoes=ECHOES):
+  lines = read_lines(path)
+  labels = {} # label: (address, loops it is in)
+  resync = None
+  code = []
+  fixups = [] # (offset in code, label, where, loops it is in)
+  loops = []
+
+  for where in lines:
+    name, line, text = where
+    op, *operands = text.split()
+    place = "{}:{}".format(name, line)
+    if op.endswith(":") and not operands:
+      if op[:-1] in labels:
+        raise ScriptError("{}: label {} is defined twice".format(place, op[:-1]))
+      labels[op[:-1]] = (2 + len(code), tuple(loops))
+      continue
+    op = op.lower()
+    try:
+      if op == ".resync":
+        resync = (operands[0], place)
+      elif op == "report":
+        b, hat, lx, ly, n = operands
+        code += [REPORT] + word(buttons(b)) + [HATS[hat], stick(lx), stick(ly)] + word(number(n, echoes))
+      elif op == "wait":
+        code += [REPORT] + word(0) + [HATS["center"], 128, 128] + word(number(operands[0], echoes))
+      elif op == "press":
+        n = number(operands[1], echoes) if len(operands) > 1 else 1
+        code += [REPORT] + word(buttons(operands[0])) + [HATS["center"], 128, 128] + word(n)
+      elif op == "stick":
+        b = buttons(operands[3]) if len(operands) > 3 else 0
+        code += [REPORT] + word(b) + [HATS["center"], stick(operands[0]), stick(operands[1])] + word(number(operands[2], echoes))
+      elif op == "setxy":
+        code += [SETXY] + word(number(operands[0], echoes, 0, imagelib.WIDTH - 1)) + [number(operands[1], echoes, 0, imagelib.HEIGHT - 1)]
+      elif op == "loop":
+        code += [LOOP] + word(number(operands[0], echoes, 1))
+        loops.append(place)
+        if len(loops) > LOOP_DEPTH:
+          raise ValueError("loops nest deeper than {}".format(LOOP_DEPTH))
+      elif op == "next":
+        if not loops:
+          raise ValueError("next without a loop")
+        loops.pop()
+        code += [NEXT]
+      elif op == "jump":
+        fixups.append((len(code) + 1, operands[0], place, tuple(loops)))
+        code += [JUMP, 0, 0]
+      elif op in ("move", "step"):
+        code += [MOVE if op == "move" else STEP, DIRECTIONS[operands[0]]] + word(number(operands[1], echoes))
+      elif op == "fix":
+        code += [FIX, FIX_ONE_PASS if operands == ["onepass"] else FIX_TWO_PASS]
+      elif op in ("ink", "span", "plan", "resume", "end"):
+        code += [{"ink": INK, "span": SPAN, "plan": PLAN, "resume": RESUME, "end": END}[op]]
+      else:
+        raise ValueError("unknown op {}".format(op))
+    except (ValueError, KeyError, IndexError) as e:
+      raise ScriptError("{}: {} ({})".format(place, text, e))
+
+  if loops:
+    raise ScriptError("{}: loop without a next".format(loops[-1]))
+  # The firmware keeps a frame per loop it entered through its loop op, a jump into or out of a
+  # loop would leave the next op with the wrong frame
+  for offset, label, place, within in fixups:
+    if label not in labels:
+      raise ScriptError("{}: unknown label {}".format(place, label))
+    if labels[label][1] != within:
+      raise ScriptError("{}: jump {} goes into or out of a loop".format(place, label))
+    code[offset:offset + 2] = word(labels[label][0])
+  handler = NO_HANDLER
+  if resync:
+    if resync[0] not in labels:
+      raise ScriptError("{}: unknown label {}".format(resync[1], resync[0]))
+    # The handler starts with no loop
+    if labels[resync[0]][1]:
+      raise ScriptError("{}: the resync handler {} is inside a loop".format(resync[1], resync[0]))
+    handler = labels[resync[0]][0]
+  return bytes(word(handler) + code)
+
+def write_script(code, path, empty=False):
+  with open(path, 'w') as f:
+    f.write(imagelib.C_HEADER)
+    f.write("const uint16_t script_length = {};\n".format(0 if empty else len(code)))
+    f.write("const uint8_t script_data[] PROGMEM = {")
+    f.write("".join(map("{:#x}, ".format, code)) + "0x0};\n")
+
+def usage():
+  print("To assemble a script: script2c.py <yourScript.script>")
+  print("To save it elsewhere: script2c.py -o script.c <yourScript.script>")
+  print("To convert ms for a firmware built with other ECHOES: script2c.py -e 3 <yourScript.script>")
+  print("To empty script.c: script2c.py -c")
+  print("The scripts/ directory has the firmware's own print, spans, plan and correction as scripts")
+
+if __name__ == "__main__":
+  if len(sys.argv[1:]) == 0:
+    usage()
+    sys.exit()
+  else:
+    main(sys.argv[1:])
@@ -0,0 +1,254 @@
+/** \file
+ *
+ *  A model of Splatoon's post editor: the cursor moves one pixel per D-pad press, or
+ *  continuously with the stick, and is clamped to the canvas. A inks and B erases under
+ *  the brush for as long as they are held.
+ */
+
+#include "Canvas.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int brush_sizes[] = CANVAS_BRUSH_SIZES;
+#define BRUSH_COUNT (int)(sizeof(brush_sizes) / sizeof(brush_sizes[0]))
+
+// D-pad directions, indexed by the HAT value
+static const int hat_dx[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+static const int hat_dy[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+void Canvas_Init(Canvas_t* const Canvas)
+{
+	memset(Canvas, 0, sizeof(Canvas_t));
+	Canvas->X = CANVAS_WIDTH / 2;
+	Canvas->Y = CANVAS_HEIGHT / 2;
+	Canvas->Last.HAT = HAT_CENTER;
+	Canvas->Last.LX = STICK_CENTER;
+	Canvas->Last.LY = STICK_CENTER;
+	Canvas->Last.RX = STICK_CENTER;
+	Canvas->Last.RY = STICK_CENTER;
+}
+
+// Paint under the brush if A or B is held.
+static void Canvas_Stamp(Canvas_t* const Canvas, const uint16_t Button)
+{
+	int half = brush_sizes[Canvas->Brush] / 2;
+	uint8_t ink;
+
+	if (Button & SWITCH_A)
+		ink = 1;
+	else if (Button & SWITCH_B)
+		ink = 0;
+	else
+		return;
+
+	for (int y = Canvas->Y - half; y <= Canvas->Y + half; y++)
+		for (int x = Canvas->X - half; x <= Canvas->X + half; x++)
+			if (x >= 0 && x < CANVAS_WIDTH && y >= 0 && y < CANVAS_HEIGHT)
+				Canvas->Pixels[y][x] = ink;
+}
+
+// Move one pixel, painting along the way.
+static void Canvas_Step(Canvas_t* const Canvas, const int DX, const int DY, const uint16_t Button)
+{
+	Canvas->X += DX;
+	Canvas->Y += DY;
+	if (Canvas->X < 0)
+		Canvas->X = 0;
+	if (Canvas->X > CANVAS_WIDTH - 1)
+		Canvas->X = CANVAS_WIDTH - 1;
+	if (Canvas->Y < 0)
+		Canvas->Y = 0;
+	if (Canvas->Y > CANVAS_HEIGHT - 1)
+		Canvas->Y = CANVAS_HEIGHT - 1;
+
+	Canvas_Stamp(Canvas, Button);
+}
+
+// Accumulate one stick axis, returns the whole pixels to move.
+static int Canvas_StickPixels(int* const Sub, const uint8_t Value)
+{
+	int tilt = Value - STICK_CENTER;
+	int pixels;
+
+	if (abs(tilt) < CANVAS_STICK_DEADZONE)
+	{
+		*Sub = 0;
+		return 0;
+	}
+
+	*Sub += tilt * CANVAS_STICK_PX_PER_FRAME;
+	pixels = *Sub / 128;
+	*Sub -= pixels * 128;
+	return pixels;
+}
+
+void Canvas_Frame(Canvas_t* const Canvas, const USB_JoystickReport_Input_t* const Report)
+{
+	uint16_t pressed = Report->Button & ~Canvas->Last.Button;
+	int dx;
+	int dy;
+
+	// Clicking the stick clears the canvas, L and R change the brush
+	if (pressed & SWITCH_LCLICK)
+		memset(Canvas->Pixels, 0, sizeof(Canvas->Pixels));
+	if ((pressed & SWITCH_L) && Canvas->Brush > 0)
+		Canvas->Brush--;
+	if ((pressed & SWITCH_R) && Canvas->Brush < BRUSH_COUNT - 1)
+		Canvas->Brush++;
+
+	// The D-pad moves one pixel per press, then repeats when held
+	if (Report->HAT < HAT_CENTER)
+	{
+		if (Report->HAT != Canvas->Last.HAT)
+			Canvas->HatFrames = 0;
+		else
+			Canvas->HatFrames++;
+
+		if (Canvas->HatFrames == 0 || (Canvas->HatFrames >= CANVAS_HAT_REPEAT_DELAY
+			&& (Canvas->HatFrames - CANVAS_HAT_REPEAT_DELAY) % CANVAS_HAT_REPEAT_INTERVAL == 0))
+			Canvas_Step(Canvas, hat_dx[Report->HAT], hat_dy[Report->HAT], Report->Button);
+	}
+
+	// The stick moves continuously, painting every pixel it crosses
+	dx = Canvas_StickPixels(&Canvas->SubX, Report->LX);
+	dy = Canvas_StickPixels(&Canvas->SubY, Report->LY);
+	while (dx != 0 || dy != 0)
+	{
+		int sx = dx > 0 ? 1 : dx < 0 ? -1 : 0;
+		int sy = dy > 0 ? 1 : dy < 0 ? -1 : 0;
+		Canvas_Step(Canvas, sx, sy, Report->Button);
+		dx -= sx;
+		dy -= sy;
+	}
+
+	Canvas_Stamp(Canvas, Report->Button);
+	memcpy(&Canvas->Last, Report, sizeof(USB_JoystickReport_Input_t));
+}
+
+bool Canvas_LoadData(Canvas_t* const Canvas, const char* const Path)
+{
+	FILE* f = fopen(Path, "rb");
+	uint8_t row[CANVAS_WIDTH];
+
+	if (f == NULL)
+		return false;
+	for (int y = 0; y < CANVAS_HEIGHT; y++)
+	{
+		if (fread(row, 1, CANVAS_WIDTH, f) != CANVAS_WIDTH)
+		{
+			fclose(f);
+			return false;
+		}
+		for (int x = 0; x < CANVAS_WIDTH; x++)
+			Canvas->Pixels[y][x] = row[x] ? 1 : 0;
+	}
+
+	fclose(f);
+	return true;
+}
+
+bool Canvas_SaveData(const Canvas_t* const Canvas, const char* const Path)
+{
+	FILE* f = fopen(Path, "wb");
+	bool ok;
+
+	if (f == NULL)
+		return false;
+	ok = fwrite(Canvas->Pixels, 1, sizeof(Canvas->Pixels), f) == sizeof(Canvas->Pixels);
+	fclose(f);
+	return ok;
+}
+
+static uint32_t crc_table[256];
+
+static uint32_t Canvas_CRC32(uint32_t crc, const uint8_t* data, size_t length)
+{
+	if (crc_table[1] == 0)
+	{
+		for (uint32_t n = 0; n < 256; n++)
+		{
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			crc_table[n] = c;
+		}
+	}
+
+	crc = ~crc;
+	while (length--)
+		crc = crc_table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void Canvas_PutBE32(uint8_t* p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static void Canvas_WriteChunk(FILE* f, const char* type, const uint8_t* data, uint32_t length)
+{
+	uint8_t header[8];
+	uint8_t crc[4];
+
+	Canvas_PutBE32(header, length);
+	memcpy(header + 4, type, 4);
+	Canvas_PutBE32(crc, Canvas_CRC32(Canvas_CRC32(0, header + 4, 4), data, length));
+
+	fwrite(header, 1, 8, f);
+	fwrite(data, 1, length, f);
+	fwrite(crc, 1, 4, f);
+}
+
+bool Canvas_SavePNG(const Canvas_t* const Canvas, const char* const Path)
+{
+	static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	// Each row is a filter byte and 40 bytes of pixels, stored in a single uncompressed deflate block
+	enum { ROW = 1 + CANVAS_WIDTH / 8, RAW = ROW * CANVAS_HEIGHT };
+	uint8_t ihdr[13] = {0};
+	uint8_t idat[2 + 5 + RAW + 4];
+	uint8_t* raw = idat + 7;
+	uint32_t a = 1;
+	uint32_t b = 0;
+	FILE* f;
+
+	Canvas_PutBE32(ihdr, CANVAS_WIDTH);
+	Canvas_PutBE32(ihdr + 4, CANVAS_HEIGHT);
+	ihdr[8] = 1; // 1 bit
+	ihdr[9] = 0; // grayscale
+
+	idat[0] = 0x78;
+	idat[1] = 0x01;
+	idat[2] = 0x01; // final stored block
+	idat[3] = RAW & 0xFF;
+	idat[4] = RAW >> 8;
+	idat[5] = ~RAW & 0xFF;
+	idat[6] = (~RAW >> 8) & 0xFF;
+
+	memset(raw, 0, RAW);
+	for (int y = 0; y < CANVAS_HEIGHT; y++)
+		for (int x = 0; x < CANVAS_WIDTH; x++)
+			if (!Canvas->Pixels[y][x])
+				raw[y * ROW + 1 + x / 8] |= 0x80 >> (x % 8);
+
+	for (int i = 0; i < RAW; i++)
+	{
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	Canvas_PutBE32(raw + RAW, (b << 16) | a);
+
+	f = fopen(Path, "wb");
+	if (f == NULL)
+		return false;
+	fwrite(signature, 1, sizeof(signature), f);
+	Canvas_WriteChunk(f, "IHDR", ihdr, sizeof(ihdr));
+	Canvas_WriteChunk(f, "IDAT", idat, sizeof(idat));
+	Canvas_WriteChunk(f, "IEND", NULL, 0);
+	fclose(f);
+	return true;
+}
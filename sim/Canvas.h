@@ -0,0 +1,68 @@
+/** \file
+ *
+ *  Header file for Canvas.c.
+ */
+
+#ifndef _CANVAS_H_
+#define _CANVAS_H_
+
+// Includes
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Joystick.h"
+
+// Macros
+#define CANVAS_WIDTH  320
+#define CANVAS_HEIGHT 120
+
+// How Splatoon reacts to the controller. These are estimates, tune them to match the console.
+// Time between two frames, in microseconds.
+#ifndef CANVAS_FRAME_US
+#define CANVAS_FRAME_US 16667
+#endif
+// Cursor speed with the stick fully tilted, in pixels per frame.
+#ifndef CANVAS_STICK_PX_PER_FRAME
+#define CANVAS_STICK_PX_PER_FRAME 6
+#endif
+// Stick values closer than this to the center are ignored.
+#ifndef CANVAS_STICK_DEADZONE
+#define CANVAS_STICK_DEADZONE 16
+#endif
+// Frames a D-pad direction is held before it starts repeating, and frames between repeats.
+#ifndef CANVAS_HAT_REPEAT_DELAY
+#define CANVAS_HAT_REPEAT_DELAY 15
+#endif
+#ifndef CANVAS_HAT_REPEAT_INTERVAL
+#define CANVAS_HAT_REPEAT_INTERVAL 3
+#endif
+// Brush widths in pixels, from the pixel brush up. L steps down, R steps up.
+#ifndef CANVAS_BRUSH_SIZES
+#define CANVAS_BRUSH_SIZES {1, 3, 7}
+#endif
+
+// Type Defines
+// The post canvas and the cursor on it.
+typedef struct {
+	uint8_t Pixels[CANVAS_HEIGHT][CANVAS_WIDTH]; // 1 for black, 0 for white
+	int     X;
+	int     Y;
+	int     SubX;      // Stick movement below one pixel, in 1/128 px
+	int     SubY;
+	int     Brush;     // Index in CANVAS_BRUSH_SIZES
+	int     HatFrames; // Frames the current D-pad direction has been held
+	USB_JoystickReport_Input_t Last; // Report seen on the previous frame
+} Canvas_t;
+
+// Function Prototypes
+// Blank canvas, cursor in the middle, pixel brush selected.
+void Canvas_Init(Canvas_t* const Canvas);
+// Apply the report the game sees on one frame.
+void Canvas_Frame(Canvas_t* const Canvas, const USB_JoystickReport_Input_t* const Report);
+// Load or save the canvas as a .data file, one byte per pixel.
+bool Canvas_LoadData(Canvas_t* const Canvas, const char* const Path);
+bool Canvas_SaveData(const Canvas_t* const Canvas, const char* const Path);
+// Save the canvas as a 1 bit grayscale PNG.
+bool Canvas_SavePNG(const Canvas_t* const Canvas, const char* const Path);
+
+#endif
@@ -0,0 +1,92 @@
+/** \file
+ *
+ *  Switch-like faults for the simulator: polls the host drops, jitter on the poll interval,
+ *  and lag spikes where the game stops taking input, like the two per print the README warns
+ *  about.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Faults.h"
+
+// Rough guesses, tune them to match the console
+static const FaultProfile_t profiles[] = {
+	//  name        drop  jitter  spikes  min ms  max ms  window s
+	{"none",        0,    0,      0,      0,      0,      0},
+	{"handheld",    1,    500,    0,      0,      0,      0},
+	{"docked",      2,    1000,   2,      200,    800,    1800},
+	{"bad-dock",    10,   2000,   4,      500,    2500,   1800},
+};
+
+const FaultProfile_t* Faults_Find(const char* const Name)
+{
+	for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+		if (strcmp(profiles[i].Name, Name) == 0)
+			return &profiles[i];
+	return NULL;
+}
+
+void Faults_List(void)
+{
+	for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+		printf("%s\n", profiles[i].Name);
+}
+
+// xorshift32, the same sequence on every platform
+static uint32_t Faults_Next(Faults_t* const Faults)
+{
+	uint32_t x = Faults->Random;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return Faults->Random = x;
+}
+
+// Uniform in [Min, Max]
+static uint32_t Faults_Range(Faults_t* const Faults, const uint32_t Min, const uint32_t Max)
+{
+	return Max > Min ? Min + Faults_Next(Faults) % (Max - Min + 1) : Min;
+}
+
+void Faults_Init(Faults_t* const Faults, const FaultProfile_t* const Profile, const uint32_t Seed)
+{
+	memset(Faults, 0, sizeof(*Faults));
+	Faults->Profile = Profile;
+	Faults->Random = Seed ? Seed : 1;
+
+	for (int i = 0; i < Profile->Spikes && i < FAULTS_MAX_SPIKES; i++)
+	{
+		Faults->SpikeStart[i] = (uint64_t)Faults_Range(Faults, 0, Profile->SpikeWindowS * 1000) * 1000;
+		Faults->SpikeEnd[i] = Faults->SpikeStart[i] + (uint64_t)Faults_Range(Faults, Profile->SpikeMinMs, Profile->SpikeMaxMs) * 1000;
+	}
+}
+
+bool Faults_DropPoll(Faults_t* const Faults)
+{
+	if (Faults->Profile->DropPerMille == 0 || Faults_Next(Faults) % 1000 >= Faults->Profile->DropPerMille)
+		return false;
+	Faults->Dropped++;
+	return true;
+}
+
+uint32_t Faults_PollInterval(Faults_t* const Faults, const uint32_t IntervalUs)
+{
+	uint32_t jitter = Faults->Profile->JitterUs;
+	if (jitter == 0)
+		return IntervalUs;
+	return IntervalUs - jitter + Faults_Range(Faults, 0, 2 * jitter);
+}
+
+bool Faults_StaleFrame(Faults_t* const Faults, const uint64_t Now)
+{
+	for (int i = 0; i < Faults->Profile->Spikes && i < FAULTS_MAX_SPIKES; i++)
+	{
+		if (Now >= Faults->SpikeStart[i] && Now < Faults->SpikeEnd[i])
+		{
+			Faults->Stale++;
+			return true;
+		}
+	}
+	return false;
+}
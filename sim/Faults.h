@@ -0,0 +1,52 @@
+/** \file
+ *
+ *  Header file for Faults.c.
+ */
+
+#ifndef _FAULTS_H_
+#define _FAULTS_H_
+
+// Includes
+#include <stdbool.h>
+#include <stdint.h>
+
+// Type Defines
+// How badly the simulated Switch behaves. All the faults are drawn from a seeded generator, so a
+// profile and a seed always give the same print.
+typedef struct {
+	const char* Name;
+	uint16_t DropPerMille;   // Polls skipped by the host, per thousand
+	uint32_t JitterUs;       // Each poll interval is off by up to this much, either way
+	uint8_t  Spikes;         // Lag spikes in a print, during which the game sees no new input
+	uint32_t SpikeMinMs;
+	uint32_t SpikeMaxMs;
+	uint32_t SpikeWindowS;   // Spikes start at random within this long from the start
+} FaultProfile_t;
+
+#define FAULTS_MAX_SPIKES 8
+
+// A fault profile being played.
+typedef struct {
+	const FaultProfile_t* Profile;
+	uint32_t Random;
+	uint64_t SpikeStart[FAULTS_MAX_SPIKES];
+	uint64_t SpikeEnd[FAULTS_MAX_SPIKES];
+	uint32_t Dropped;        // Polls dropped so far
+	uint32_t Stale;          // Frames that saw no new input so far
+} Faults_t;
+
+// Function Prototypes
+// Look up a profile by name, NULL if there's none.
+const FaultProfile_t* Faults_Find(const char* const Name);
+// Print the profile names, one per line.
+void Faults_List(void);
+// Start playing a profile, with the spikes laid out from the seed.
+void Faults_Init(Faults_t* const Faults, const FaultProfile_t* const Profile, const uint32_t Seed);
+// Whether the host skips the poll due now.
+bool Faults_DropPoll(Faults_t* const Faults);
+// Time until the next poll, in microseconds.
+uint32_t Faults_PollInterval(Faults_t* const Faults, const uint32_t IntervalUs);
+// Whether the game is in a lag spike on the frame due at Now.
+bool Faults_StaleFrame(Faults_t* const Faults, const uint64_t Now);
+
+#endif
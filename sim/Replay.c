@@ -0,0 +1,193 @@
+/** \file
+ *
+ *  Replay report traces recorded by the simulator (-t) on the canvas model: render one, or
+ *  diff two to see exactly what a change to the firmware did to the report stream and the
+ *  printout.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Canvas.h"
+#include "Trace.h"
+
+#define TAG_COUNT 256
+
+// Show the trace to the game one frame at a time, as the simulator does
+static void Render(const Trace_t* const Trace, Canvas_t* const Canvas)
+{
+	USB_JoystickReport_Input_t report;
+	uint64_t end = Trace->Length ? Trace->Records[Trace->Length - 1].TimeUs : 0;
+	uint32_t next = 0;
+
+	memset(&report, 0, sizeof(report));
+	report.HAT = HAT_CENTER;
+	report.LX = report.LY = report.RX = report.RY = STICK_CENTER;
+
+	Canvas_Init(Canvas);
+	for (uint64_t frame = 0; frame <= end + CANVAS_FRAME_US; frame += CANVAS_FRAME_US)
+	{
+		while (next < Trace->Length && Trace->Records[next].TimeUs <= frame)
+			report = Trace->Records[next++].Report;
+		Canvas_Frame(Canvas, &report);
+	}
+}
+
+// Time spent in each tag, in us
+static void TagTimes(const Trace_t* const Trace, uint64_t* const Times)
+{
+	memset(Times, 0, TAG_COUNT * sizeof(uint64_t));
+	for (uint32_t i = 1; i < Trace->Length; i++)
+		Times[Trace->Records[i - 1].Tag] += Trace->Records[i].TimeUs - Trace->Records[i - 1].TimeUs;
+}
+
+static void PrintReport(const char* const Name, const TraceRecord_t* const Record)
+{
+	printf("  %s  %8.3fs  %-8s  button %04x  hat %u  L %3u,%3u  R %3u,%3u\n", Name, Record->TimeUs / 1e6,
+		Trace_TagName(Record->Tag), Record->Report.Button, Record->Report.HAT,
+		Record->Report.LX, Record->Report.LY, Record->Report.RX, Record->Report.RY);
+}
+
+static bool SameReport(const TraceRecord_t* const A, const TraceRecord_t* const B)
+{
+	return A->Tag == B->Tag && A->Report.Button == B->Report.Button && A->Report.HAT == B->Report.HAT
+		&& A->Report.LX == B->Report.LX && A->Report.LY == B->Report.LY
+		&& A->Report.RX == B->Report.RX && A->Report.RY == B->Report.RY;
+}
+
+static void Usage(void)
+{
+	printf("Usage: replay [-o canvas.png] [-d canvas.data] trace\n");
+	printf("       replay [-o diff.png] a.trace b.trace\n");
+	printf("  With one trace, render it on the canvas model.\n");
+	printf("  With two, compare the reports and the canvases they give, exit status 1 if they differ.\n");
+	printf("  -o  save the canvas as a PNG, or with two traces the pixels that differ in black\n");
+	printf("  -d  save the canvas as a .data file\n");
+}
+
+int main(int argc, char* argv[])
+{
+	const char* png_path = NULL;
+	const char* data_path = NULL;
+	static Canvas_t canvases[2];
+	static uint64_t times[2][TAG_COUNT];
+	Trace_t traces[2];
+	int count;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "o:d:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 'o':
+			png_path = optarg;
+			break;
+		case 'd':
+			data_path = optarg;
+			break;
+		default:
+			Usage();
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	count = argc - optind;
+	if (count != 1 && count != 2)
+	{
+		Usage();
+		return 1;
+	}
+	for (int i = 0; i < count; i++)
+	{
+		if (!Trace_Load(&traces[i], argv[optind + i]))
+		{
+			fprintf(stderr, "Could not read %s as a trace\n", argv[optind + i]);
+			return 1;
+		}
+		Render(&traces[i], &canvases[i]);
+		TagTimes(&traces[i], times[i]);
+	}
+
+	if (count == 1)
+	{
+		const Trace_t* trace = &traces[0];
+		int black = 0;
+
+		for (int y = 0; y < CANVAS_HEIGHT; y++)
+			for (int x = 0; x < CANVAS_WIDTH; x++)
+				black += canvases[0].Pixels[y][x];
+		printf("Reports:        %u\n", trace->Length);
+		printf("Duration:       %.1fs\n", trace->Length ? trace->Records[trace->Length - 1].TimeUs / 1e6 : 0);
+		for (int tag = 0; tag < TAG_COUNT; tag++)
+			if (times[0][tag])
+				printf("  %-12s  %8.1fs\n", Trace_TagName(tag), times[0][tag] / 1e6);
+		printf("Black pixels:   %d\n", black);
+		if (png_path != NULL && !Canvas_SavePNG(&canvases[0], png_path))
+			fprintf(stderr, "Could not save %s\n", png_path);
+		if (data_path != NULL && !Canvas_SaveData(&canvases[0], data_path))
+			fprintf(stderr, "Could not save %s\n", data_path);
+		Trace_Free(&traces[0]);
+		return 0;
+	}
+
+	// Reports, side by side
+	uint32_t shortest = traces[0].Length < traces[1].Length ? traces[0].Length : traces[1].Length;
+	uint32_t first = shortest;
+	uint32_t differing = 0;
+	for (uint32_t i = 0; i < shortest; i++)
+	{
+		if (!SameReport(&traces[0].Records[i], &traces[1].Records[i]))
+		{
+			if (first == shortest)
+				first = i;
+			differing++;
+		}
+	}
+
+	printf("%-14s %14s %14s\n", "", "a", "b");
+	printf("%-14s %14u %14u\n", "reports", traces[0].Length, traces[1].Length);
+	printf("%-14s %13.1fs %13.1fs\n", "duration",
+		traces[0].Length ? traces[0].Records[traces[0].Length - 1].TimeUs / 1e6 : 0,
+		traces[1].Length ? traces[1].Records[traces[1].Length - 1].TimeUs / 1e6 : 0);
+	for (int tag = 0; tag < TAG_COUNT; tag++)
+		if (times[0][tag] || times[1][tag])
+			printf("  %-12s %13.1fs %13.1fs\n", Trace_TagName(tag), times[0][tag] / 1e6, times[1][tag] / 1e6);
+
+	if (first < shortest)
+	{
+		printf("%u reports differ, the first is report %u:\n", differing, first);
+		PrintReport("a", &traces[0].Records[first]);
+		PrintReport("b", &traces[1].Records[first]);
+	}
+	else if (traces[0].Length != traces[1].Length)
+		printf("The reports are the same up to the end of the shorter trace\n");
+	else
+		printf("The reports are the same\n");
+
+	// Canvases
+	static Canvas_t diff;
+	int pixels = 0;
+	int rows = 0;
+	Canvas_Init(&diff);
+	for (int y = 0; y < CANVAS_HEIGHT; y++)
+	{
+		int row_pixels = 0;
+		for (int x = 0; x < CANVAS_WIDTH; x++)
+		{
+			diff.Pixels[y][x] = canvases[0].Pixels[y][x] != canvases[1].Pixels[y][x];
+			row_pixels += diff.Pixels[y][x];
+		}
+		pixels += row_pixels;
+		rows += row_pixels > 0;
+	}
+	printf("Canvas:         %d pixels differ in %d rows\n", pixels, rows);
+	if (png_path != NULL && !Canvas_SavePNG(&diff, png_path))
+		fprintf(stderr, "Could not save %s\n", png_path);
+
+	bool same = differing == 0 && traces[0].Length == traces[1].Length && pixels == 0;
+	Trace_Free(&traces[0]);
+	Trace_Free(&traces[1]);
+	return same ? 0 : 1;
+}
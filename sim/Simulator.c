@@ -0,0 +1,519 @@
+/** \file
+ *
+ *  Host build of the printer. The firmware runs unchanged against the LUFA stand-ins in
+ *  stubs/, while this file plays the Switch: it polls the IN endpoint every POLLING_MS
+ *  and shows the last report it received to Splatoon's canvas model once per frame. A fault
+ *  profile (see Faults.c) can make it drop polls, jitter and lag like a real console.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Joystick.h"
+#include "Canvas.h"
+#include "Faults.h"
+#include "Trace.h"
+
+// Firmware state, for the trace tags, and the image it prints
+extern State_t state;
+extern bool isLineThatNeedsCorrection;
+extern int echoes;
+extern volatile bool needs_resync;
+extern const uint8_t *current_image;
+
+// The EEPROM, every EEMEM variable of the firmware (see stubs/avr/eeprom.h)
+#ifdef __APPLE__
+extern uint8_t eeprom_start[] __asm("section$start$__DATA$sim_eeprom");
+extern uint8_t eeprom_end[] __asm("section$end$__DATA$sim_eeprom");
+#else
+extern uint8_t __start_sim_eeprom[];
+extern uint8_t __stop_sim_eeprom[];
+#define eeprom_start __start_sim_eeprom
+#define eeprom_end __stop_sim_eeprom
+#endif
+
+// Simulated timings, in microseconds
+#define SIM_POLL_US  (POLLING_MS * 1000)
+// The print is over once the firmware is done and nothing was pressed for this long (it may
+// wait longer than that in other states, when syncing or between the posts of a queue)
+#define SIM_IDLE_US  (10 * 1000000ULL)
+// Give up after this long, a queue of posts takes hours
+#define SIM_LIMIT_US (12 * 3600 * 1000000ULL)
+// USB drops (-d): the cable is plugged back after this long
+#define SIM_RECONNECT_US (1 * 1000000ULL)
+#define SIM_MAX_DROPS    16
+
+// LUFA and AVR globals the firmware expects
+uint8_t MCUSR;
+uint8_t SREG;
+uint8_t TCCR1A;
+uint8_t TCCR1B;
+uint8_t TIMSK1;
+uint8_t TIFR1;
+uint16_t TCNT1;
+uint16_t UBRR1;
+uint8_t UCSR1A;
+uint8_t UCSR1B;
+uint8_t UCSR1C;
+uint8_t UDR1;
+uint8_t PINB; // The queue trigger is always pressed
+uint8_t DDRB;
+uint8_t PORTB;
+volatile uint8_t USB_DeviceState = DEVICE_STATE_Unattached;
+USB_Request_Header_t USB_ControlRequest;
+
+// Simulated host state
+static uint8_t selected_endpoint;
+static bool in_ready;
+static bool in_written;
+static USB_JoystickReport_Input_t in_buffer;
+static USB_JoystickReport_Input_t received;
+static uint32_t report_count;
+static uint8_t control_buffer[512];
+static uint16_t control_length;
+
+void USB_Init(void)
+{
+	USB_DeviceState = DEVICE_STATE_Configured;
+	EVENT_USB_Device_Connect();
+	EVENT_USB_Device_ConfigurationChanged();
+}
+
+void USB_USBTask(void)
+{
+}
+
+bool Endpoint_ConfigureEndpoint(const uint8_t Address, const uint8_t Type, const uint16_t Size, const uint8_t Banks)
+{
+	return true;
+}
+
+void Endpoint_SelectEndpoint(const uint8_t Address)
+{
+	selected_endpoint = Address;
+}
+
+bool Endpoint_IsOUTReceived(void)
+{
+	return false;
+}
+
+bool Endpoint_IsINReady(void)
+{
+	return selected_endpoint == JOYSTICK_IN_EPADDR && in_ready;
+}
+
+bool Endpoint_IsReadWriteAllowed(void)
+{
+	return true;
+}
+
+uint8_t Endpoint_Read_Stream_LE(void* const Buffer, uint16_t Length, uint16_t* const BytesProcessed)
+{
+	memset(Buffer, 0, Length);
+	return 0;
+}
+
+uint8_t Endpoint_Write_Stream_LE(const void* const Buffer, uint16_t Length, uint16_t* const BytesProcessed)
+{
+	memcpy(&in_buffer, Buffer, Length < sizeof(in_buffer) ? Length : sizeof(in_buffer));
+	in_written = true;
+	return 0;
+}
+
+void Endpoint_ClearOUT(void)
+{
+}
+
+void Endpoint_ClearIN(void)
+{
+	if (selected_endpoint == JOYSTICK_IN_EPADDR && in_written)
+	{
+		memcpy(&received, &in_buffer, sizeof(received));
+		in_ready = false;
+		in_written = false;
+		report_count++;
+	}
+}
+
+void Endpoint_ClearSETUP(void)
+{
+}
+
+uint8_t Endpoint_Write_Control_Stream_LE(const void* const Buffer, uint16_t Length)
+{
+	if (Length > USB_ControlRequest.wLength)
+		Length = USB_ControlRequest.wLength;
+	if (Length > sizeof(control_buffer))
+		Length = sizeof(control_buffer);
+	memcpy(control_buffer, Buffer, Length);
+	control_length = Length;
+	return 0;
+}
+
+#ifdef COUNTERS_TIMER
+void TIMER1_OVF_vect(void);
+
+// Run Timer1 up to the simulated time
+static void RunTimer1(const uint64_t Now)
+{
+	static uint64_t overflows = 0;
+	uint64_t ticks = Now * COUNTERS_TICKS_PER_MS / 1000;
+
+	while (overflows < ticks >> 16)
+	{
+		TIMER1_OVF_vect();
+		overflows++;
+	}
+	TCNT1 = ticks & 0xFFFF;
+}
+#endif
+
+#ifdef UART_TELEMETRY
+void USART1_UDRE_vect(void);
+
+// Send what the USART could have sent by Now to the file
+static void RunUSART1(const uint64_t Now, FILE* const File)
+{
+	static uint64_t sent = 0;
+	// 10 bits per byte
+	uint64_t budget = Now * TELEMETRY_BAUD / 10 / 1000000;
+
+	while (sent < budget && (UCSR1B & 1 << UDRIE1))
+	{
+		USART1_UDRE_vect();
+		if (UCSR1B & 1 << UDRIE1)
+		{
+			if (File != NULL)
+				fputc(UDR1, File);
+			sent++;
+		}
+	}
+	if (sent < budget)
+		sent = budget;
+}
+#endif
+
+// Read a feature report like counters.py does, false if the firmware doesn't answer
+static bool ReadFeature(const uint8_t ReportID, void* const Report, const uint16_t Length)
+{
+	USB_ControlRequest = (USB_Request_Header_t){
+		.bmRequestType = REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE,
+		.bRequest = HID_REQ_GetReport,
+		.wValue = COUNTERS_REPORT_TYPE_FEATURE << 8 | ReportID,
+		.wLength = Length,
+	};
+	control_length = 0;
+	EVENT_USB_Device_ControlRequest();
+	if (control_length != Length)
+		return false;
+	memcpy(Report, control_buffer, Length);
+	return true;
+}
+
+static void PrintCounters(void)
+{
+	Counters_t c;
+	static Timing_t t;
+	bool any = false;
+
+	if (ReadFeature(COUNTERS_REPORT_ID, &c, sizeof(c)))
+	{
+		printf("Counters:       %u reports, %u echoes, %u missed polls, %u us max gap, at %u,%u state %u\n",
+			c.Reports, c.Echoes, c.MissedPolls, c.MaxGapUs, c.XPos, c.YPos, c.State);
+		any = true;
+	}
+	if (ReadFeature(TIMING_REPORT_ID, &t, sizeof(t)))
+	{
+		printf("Poll gaps:\n");
+		for (int i = 0; i < TIMING_BUCKETS; i++)
+			if (t.Histogram[i])
+				printf("  %6u-%-6u us  %u\n", 1u << i, (2u << i) - 1, t.Histogram[i]);
+		any = true;
+	}
+	if (!any)
+		fprintf(stderr, "No performance counters, build with -DPERF_COUNTERS or -DTIMING_TRACE\n");
+}
+
+static bool IsNeutral(const USB_JoystickReport_Input_t* const Report)
+{
+	return Report->Button == 0 && Report->HAT == HAT_CENTER
+		&& Report->LX == STICK_CENTER && Report->LY == STICK_CENTER
+		&& Report->RX == STICK_CENTER && Report->RY == STICK_CENTER;
+}
+
+static void Usage(void)
+{
+	printf("Usage: simulator [-c canvas.data] [-o canvas.png] [-D canvas.data] [-d seconds,...] [-e eeprom.bin] [-R seconds] [-f profile] [-s seed] [-t trace] [-r] [-u telemetry] [-q]\n");
+	printf("  -c  start from this canvas (one byte per pixel) instead of a blank one\n");
+	printf("  -o  save the final canvas as a PNG (default sim_canvas.png)\n");
+	printf("  -D  also save the final canvas as a .data file\n");
+	printf("  -d  drop the USB connection at these times (in s, in order), for 1 s each\n");
+	printf("  -e  start with this EEPROM if the file exists, save it there at the end\n");
+	printf("  -R  cut the power of the controller at this time (in s), the print stops there\n");
+	printf("  -f  inject faults from this profile (-f list to show them, default none)\n");
+	printf("  -s  seed for the faults (default 1)\n");
+	printf("  -t  record the reports to this trace file (see Trace.h)\n");
+	printf("  -r  read the performance counters at the end (build with -DPERF_COUNTERS or -DTIMING_TRACE)\n");
+	printf("  -u  save the UART telemetry to this file (build with -DUART_TELEMETRY)\n");
+	printf("  -q  print a single key=value line\n");
+}
+
+// Load the EEPROM saved by an earlier run, it stays blank (erased) when there is no such file.
+static bool LoadEEPROM(const char* const Path)
+{
+	FILE* file = fopen(Path, "rb");
+	size_t size = eeprom_end - eeprom_start;
+
+	memset(eeprom_start, 0xFF, size);
+	if (file == NULL)
+		return true;
+	bool ok = fread(eeprom_start, 1, size, file) == size;
+	fclose(file);
+	return ok;
+}
+
+static bool SaveEEPROM(const char* const Path)
+{
+	FILE* file = fopen(Path, "wb");
+	size_t size = eeprom_end - eeprom_start;
+
+	if (file == NULL)
+		return false;
+	bool ok = fwrite(eeprom_start, 1, size, file) == size;
+	return fclose(file) == 0 && ok;
+}
+
+// Compare the canvas with the image being printed, adds the wrong pixels and rows.
+static void CountErrors(const Canvas_t* const Canvas, int* const Errors, int* const Rows)
+{
+	for (int y = 0; y < CANVAS_HEIGHT; y++)
+	{
+		int row_errors = 0;
+		for (int x = 0; x < CANVAS_WIDTH; x++)
+		{
+			uint8_t black = (pgm_read_byte(&current_image[x / 8 + y * 40]) >> (x % 8)) & 1;
+			if (Canvas->Pixels[y][x] != black)
+				row_errors++;
+		}
+		*Errors += row_errors;
+		*Rows += row_errors > 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const char* png_path = "sim_canvas.png";
+	const char* data_path = NULL;
+	bool quiet = false;
+	static Canvas_t canvas;
+	const FaultProfile_t* profile = Faults_Find("none");
+	uint32_t seed = 1;
+	Faults_t faults;
+	const char* trace_path = NULL;
+	TraceWriter_t trace;
+	bool read_counters = false;
+	FILE* telemetry = NULL;
+	uint64_t now = 0;
+	uint64_t next_poll = 0;
+	uint64_t next_frame = 0;
+	uint64_t last_active = 0;
+	uint32_t reports = 0;
+	int errors = 0;
+	int rows = 0;
+	int posts = 1;
+	uint64_t drops[SIM_MAX_DROPS];
+	int drop_count = 0;
+	int next_drop = 0;
+	uint64_t reconnect = 0;
+	uint8_t last_tag = TRACE_TAG_SYNC;
+	const char* eeprom_path = NULL;
+	uint64_t power_off = SIM_LIMIT_US;
+	int opt;
+
+	Canvas_Init(&canvas);
+	while ((opt = getopt(argc, argv, "c:o:D:d:e:R:f:s:t:ru:qh")) != -1)
+	{
+		switch (opt)
+		{
+		case 'c':
+			if (!Canvas_LoadData(&canvas, optarg))
+			{
+				fprintf(stderr, "Could not load %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'o':
+			png_path = optarg;
+			break;
+		case 'D':
+			data_path = optarg;
+			break;
+		case 'd':
+			for (char* time = strtok(optarg, ","); time != NULL; time = strtok(NULL, ","))
+			{
+				if (drop_count == SIM_MAX_DROPS)
+				{
+					fprintf(stderr, "At most %d drops\n", SIM_MAX_DROPS);
+					return 1;
+				}
+				drops[drop_count++] = (uint64_t)(strtod(time, NULL) * 1e6);
+			}
+			break;
+		case 'e':
+			eeprom_path = optarg;
+			break;
+		case 'R':
+			power_off = (uint64_t)(strtod(optarg, NULL) * 1e6);
+			break;
+		case 'f':
+			profile = Faults_Find(optarg);
+			if (profile == NULL)
+			{
+				if (strcmp(optarg, "list") != 0)
+					fprintf(stderr, "No fault profile named %s, pick one of:\n", optarg);
+				Faults_List();
+				return strcmp(optarg, "list") == 0 ? 0 : 1;
+			}
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			trace_path = optarg;
+			break;
+		case 'r':
+			read_counters = true;
+			break;
+		case 'u':
+			telemetry = fopen(optarg, "wb");
+			if (telemetry == NULL)
+			{
+				fprintf(stderr, "Could not write %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'q':
+			quiet = true;
+			break;
+		default:
+			Usage();
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	Faults_Init(&faults, profile, seed);
+	if (trace_path != NULL && !Trace_Open(&trace, trace_path, SIM_POLL_US))
+	{
+		fprintf(stderr, "Could not write %s\n", trace_path);
+		return 1;
+	}
+	if (eeprom_path != NULL && !LoadEEPROM(eeprom_path))
+	{
+		fprintf(stderr, "Could not load %s\n", eeprom_path);
+		return 1;
+	}
+	SetupHardware();
+	received.HAT = HAT_CENTER;
+	received.LX = received.LY = received.RX = received.RY = STICK_CENTER;
+
+	// Polls and frames interleaved in time order
+	while (now < SIM_LIMIT_US && now < power_off && (state != DONE || now - last_active < SIM_IDLE_US))
+	{
+		if (next_poll <= next_frame)
+		{
+			uint32_t sent = report_count;
+			// An echo repeats the report of the state it was sent from, which has already moved on
+			uint8_t tag = echoes > 0 && !needs_resync ? last_tag : Trace_Tag(state, isLineThatNeedsCorrection);
+
+			now = next_poll;
+#ifdef COUNTERS_TIMER
+			RunTimer1(now);
+#endif
+#ifdef UART_TELEMETRY
+			RunUSART1(now, telemetry);
+#endif
+			// Pull the cable at each drop time, the Switch sees a neutral controller until it is back
+			if (next_drop < drop_count && now >= drops[next_drop] && USB_DeviceState == DEVICE_STATE_Configured)
+			{
+				USB_DeviceState = DEVICE_STATE_Unattached;
+				EVENT_USB_Device_Disconnect();
+				memset(&received, 0, sizeof(received));
+				received.HAT = HAT_CENTER;
+				received.LX = received.LY = received.RX = received.RY = STICK_CENTER;
+				reconnect = now + SIM_RECONNECT_US;
+				next_drop++;
+			}
+			else if (USB_DeviceState != DEVICE_STATE_Configured && now >= reconnect)
+				USB_Init();
+			if (!Faults_DropPoll(&faults))
+				in_ready = true;
+			HID_Task();
+			// In queue mode each post is checked once it is finished, before it is saved
+			if (state == QUEUE && (tag & ~TRACE_TAG_CORRECTION) != TRACE_TAG_QUEUE)
+			{
+				CountErrors(&canvas, &errors, &rows);
+				posts++;
+			}
+			if (trace_path != NULL && report_count != sent)
+				Trace_Write(&trace, &(TraceRecord_t){.TimeUs = now, .Report = received, .Tag = tag});
+			last_tag = tag;
+			USB_USBTask();
+			if (!IsNeutral(&received))
+			{
+				last_active = now;
+				reports = report_count;
+			}
+			next_poll += Faults_PollInterval(&faults, SIM_POLL_US);
+		}
+		else
+		{
+			now = next_frame;
+			// The game takes no input during a lag spike, and the canvas none while the save menu
+			// is open between the posts of a queue
+			if (state == QUEUE)
+				memcpy(&canvas.Last, &received, sizeof(received));
+			else if (!Faults_StaleFrame(&faults, now))
+				Canvas_Frame(&canvas, &received);
+			next_frame += CANVAS_FRAME_US;
+		}
+	}
+
+	if (trace_path != NULL && !Trace_Close(&trace))
+		fprintf(stderr, "Could not write %s\n", trace_path);
+	if (eeprom_path != NULL && !SaveEEPROM(eeprom_path))
+		fprintf(stderr, "Could not save %s\n", eeprom_path);
+
+	// Compare with the image, the last one of a queue
+	CountErrors(&canvas, &errors, &rows);
+
+	if (png_path != NULL && !Canvas_SavePNG(&canvas, png_path))
+		fprintf(stderr, "Could not save %s\n", png_path);
+	if (data_path != NULL && !Canvas_SaveData(&canvas, data_path))
+		fprintf(stderr, "Could not save %s\n", data_path);
+
+	if (quiet)
+		printf("reports=%u seconds=%.1f errors=%d rows=%d dropped=%u stale=%u posts=%d\n", reports, last_active / 1e6,
+			errors, rows, faults.Dropped, faults.Stale, posts);
+	else
+	{
+		printf("Reports sent:   %u\n", reports);
+		printf("Simulated time: %um%02us\n", (unsigned)(last_active / 60000000), (unsigned)(last_active / 1000000 % 60));
+		if (posts > 1)
+			printf("Posts printed:  %d\n", posts);
+		printf("Pixel errors:   %d in %d rows\n", errors, rows);
+		if (profile->DropPerMille || profile->JitterUs || profile->Spikes)
+			printf("Faults (%s):  %u polls dropped, %u frames lagged\n", profile->Name, faults.Dropped, faults.Stale);
+		if (png_path != NULL)
+			printf("Canvas saved to %s\n", png_path);
+	}
+
+	if (read_counters)
+		PrintCounters();
+	if (telemetry != NULL)
+		fclose(telemetry);
+
+	return now >= SIM_LIMIT_US ? 2 : 0;
+}
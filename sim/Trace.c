@@ -0,0 +1,239 @@
+/** \file
+ *
+ *  Record and read back report traces, see Trace.h for the format.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Trace.h"
+
+static const char magic[4] = {'S', 'P', 'T', 'R'};
+
+static void Trace_Neutral(TraceRecord_t* const Record)
+{
+	memset(Record, 0, sizeof(*Record));
+	Record->Report.HAT = HAT_CENTER;
+	Record->Report.LX = Record->Report.LY = STICK_CENTER;
+	Record->Report.RX = Record->Report.RY = STICK_CENTER;
+	Record->Tag = TRACE_TAG_SYNC;
+}
+
+uint8_t Trace_Tag(const State_t State, const bool Correcting)
+{
+	uint8_t tag;
+
+	switch (State)
+	{
+	case RESUME_POSITION:
+		tag = TRACE_TAG_RESUME;
+		break;
+	case BULK_ERASE:
+		tag = TRACE_TAG_ERASE;
+		break;
+	case MOVE:
+		tag = TRACE_TAG_MOVE;
+		break;
+	case STOP:
+		tag = TRACE_TAG_STOP;
+		break;
+	case DONE:
+		tag = TRACE_TAG_DONE;
+		break;
+	case SCRIPT:
+		tag = TRACE_TAG_SCRIPT;
+		break;
+	case QUEUE:
+		tag = TRACE_TAG_QUEUE;
+		break;
+	default:
+		tag = TRACE_TAG_SYNC;
+		break;
+	}
+	return Correcting ? tag | TRACE_TAG_CORRECTION : tag;
+}
+
+const char* Trace_TagName(const uint8_t Tag)
+{
+	static const char* names[] = {"SYNC", "RESUME", "ERASE", "MOVE", "STOP", "DONE", "SCRIPT", "QUEUE"};
+	static const char* correction_names[] = {"SYNC+C", "RESUME+C", "ERASE+C", "MOVE+C", "STOP+C", "DONE+C", "SCRIPT+C", "QUEUE+C"};
+	uint8_t index = Tag & ~TRACE_TAG_CORRECTION;
+
+	if (index >= sizeof(names) / sizeof(names[0]))
+		return "?";
+	return Tag & TRACE_TAG_CORRECTION ? correction_names[index] : names[index];
+}
+
+bool Trace_Open(TraceWriter_t* const Writer, const char* const Path, const uint32_t PollUs)
+{
+	uint8_t header[12] = {0};
+
+	Writer->File = fopen(Path, "wb");
+	if (Writer->File == NULL)
+		return false;
+	Writer->PollUs = PollUs;
+	Trace_Neutral(&Writer->Last);
+
+	memcpy(header, magic, sizeof(magic));
+	header[4] = TRACE_VERSION;
+	for (int i = 0; i < 4; i++)
+		header[8 + i] = PollUs >> (8 * i);
+	fwrite(header, 1, sizeof(header), Writer->File);
+	return true;
+}
+
+void Trace_Write(TraceWriter_t* const Writer, const TraceRecord_t* const Record)
+{
+	const USB_JoystickReport_Input_t* now = &Record->Report;
+	const USB_JoystickReport_Input_t* last = &Writer->Last.Report;
+	uint64_t delta = Record->TimeUs - Writer->Last.TimeUs;
+	uint8_t buffer[20];
+	int length = 1;
+	uint8_t flags = 0;
+
+	if (delta != Writer->PollUs)
+	{
+		flags |= TRACE_HAS_TIME;
+		do
+		{
+			buffer[length++] = (delta & 0x7F) | (delta > 0x7F ? 0x80 : 0);
+			delta >>= 7;
+		} while (delta);
+	}
+	if (now->Button != last->Button)
+	{
+		flags |= TRACE_HAS_BUTTON;
+		buffer[length++] = now->Button & 0xFF;
+		buffer[length++] = now->Button >> 8;
+	}
+	if (now->HAT != last->HAT)
+	{
+		flags |= TRACE_HAS_HAT;
+		buffer[length++] = now->HAT;
+	}
+	if (now->LX != last->LX)
+	{
+		flags |= TRACE_HAS_LX;
+		buffer[length++] = now->LX;
+	}
+	if (now->LY != last->LY)
+	{
+		flags |= TRACE_HAS_LY;
+		buffer[length++] = now->LY;
+	}
+	if (now->RX != last->RX)
+	{
+		flags |= TRACE_HAS_RX;
+		buffer[length++] = now->RX;
+	}
+	if (now->RY != last->RY)
+	{
+		flags |= TRACE_HAS_RY;
+		buffer[length++] = now->RY;
+	}
+	if (Record->Tag != Writer->Last.Tag)
+	{
+		flags |= TRACE_HAS_TAG;
+		buffer[length++] = Record->Tag;
+	}
+	buffer[0] = flags;
+
+	fwrite(buffer, 1, length, Writer->File);
+	Writer->Last = *Record;
+}
+
+bool Trace_Close(TraceWriter_t* const Writer)
+{
+	bool ok = !ferror(Writer->File);
+	return fclose(Writer->File) == 0 && ok;
+}
+
+bool Trace_Load(Trace_t* const Trace, const char* const Path)
+{
+	FILE* f = fopen(Path, "rb");
+	uint8_t* data;
+	long size;
+	long at = 12;
+	uint32_t capacity = 1024;
+	TraceRecord_t record;
+
+	memset(Trace, 0, sizeof(*Trace));
+	if (f == NULL)
+		return false;
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	data = malloc(size > 0 ? size : 1);
+	if (size < 12 || fread(data, 1, size, f) != (size_t)size
+		|| memcmp(data, magic, sizeof(magic)) != 0 || data[4] != TRACE_VERSION)
+	{
+		free(data);
+		fclose(f);
+		return false;
+	}
+	fclose(f);
+
+	for (int i = 0; i < 4; i++)
+		Trace->PollUs |= (uint32_t)data[8 + i] << (8 * i);
+	Trace->Records = malloc(capacity * sizeof(TraceRecord_t));
+	Trace_Neutral(&record);
+
+	while (at < size)
+	{
+		uint8_t flags = data[at++];
+		uint64_t delta = 0;
+		int shift = 0;
+
+		if (flags & TRACE_HAS_TIME)
+		{
+			while (at < size && shift < 64)
+			{
+				uint8_t byte = data[at++];
+				delta |= (uint64_t)(byte & 0x7F) << shift;
+				shift += 7;
+				if (!(byte & 0x80))
+					break;
+			}
+		}
+		else
+			delta = Trace->PollUs;
+		record.TimeUs += delta;
+
+		// Truncated records end the trace
+		if (at + 2 * !!(flags & TRACE_HAS_BUTTON) + __builtin_popcount(flags & 0xFC) > size)
+			break;
+		if (flags & TRACE_HAS_BUTTON)
+		{
+			record.Report.Button = data[at] | data[at + 1] << 8;
+			at += 2;
+		}
+		if (flags & TRACE_HAS_HAT)
+			record.Report.HAT = data[at++];
+		if (flags & TRACE_HAS_LX)
+			record.Report.LX = data[at++];
+		if (flags & TRACE_HAS_LY)
+			record.Report.LY = data[at++];
+		if (flags & TRACE_HAS_RX)
+			record.Report.RX = data[at++];
+		if (flags & TRACE_HAS_RY)
+			record.Report.RY = data[at++];
+		if (flags & TRACE_HAS_TAG)
+			record.Tag = data[at++];
+
+		if (Trace->Length == capacity)
+		{
+			capacity *= 2;
+			Trace->Records = realloc(Trace->Records, capacity * sizeof(TraceRecord_t));
+		}
+		Trace->Records[Trace->Length++] = record;
+	}
+
+	free(data);
+	return true;
+}
+
+void Trace_Free(Trace_t* const Trace)
+{
+	free(Trace->Records);
+	memset(Trace, 0, sizeof(*Trace));
+}
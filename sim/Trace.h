@@ -0,0 +1,86 @@
+/** \file
+ *
+ *  Header file for Trace.c.
+ *
+ *  A trace is the stream of reports the host received, in a compact binary format:
+ *
+ *    header:  "SPTR", version (1 byte), 3 reserved bytes, poll interval in us (4 bytes LE)
+ *    records: one per report, starting from a neutral report with tag TRACE_SYNC at time 0
+ *      flags  1 byte, which of the fields below follow (TRACE_HAS_*)
+ *      time   LEB128 varint, us since the previous report, the poll interval if absent
+ *      button 2 bytes LE
+ *      HAT, LX, LY, RX, RY  1 byte each
+ *      tag    1 byte, the firmware state that sent the report (TRACE_TAG_*)
+ *
+ *  Only the fields that changed since the previous record are stored, so most reports take
+ *  two or three bytes.
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+// Includes
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "Joystick.h"
+
+// Macros
+#define TRACE_VERSION 1
+
+#define TRACE_HAS_TIME   0x01
+#define TRACE_HAS_BUTTON 0x02
+#define TRACE_HAS_HAT    0x04
+#define TRACE_HAS_LX     0x08
+#define TRACE_HAS_LY     0x10
+#define TRACE_HAS_RX     0x20
+#define TRACE_HAS_RY     0x40
+#define TRACE_HAS_TAG    0x80
+
+// Tags, from the firmware state. TRACE_TAG_CORRECTION is added while on a row to correct.
+#define TRACE_TAG_SYNC       0x00
+#define TRACE_TAG_RESUME     0x01
+#define TRACE_TAG_ERASE      0x02
+#define TRACE_TAG_MOVE       0x03
+#define TRACE_TAG_STOP       0x04
+#define TRACE_TAG_DONE       0x05
+#define TRACE_TAG_SCRIPT     0x06
+#define TRACE_TAG_QUEUE      0x07
+#define TRACE_TAG_CORRECTION 0x80
+
+// Type Defines
+typedef struct {
+	uint64_t TimeUs;
+	USB_JoystickReport_Input_t Report;
+	uint8_t  Tag;
+} TraceRecord_t;
+
+// A trace being written.
+typedef struct {
+	FILE*    File;
+	uint32_t PollUs;
+	TraceRecord_t Last;
+} TraceWriter_t;
+
+// A trace read into memory.
+typedef struct {
+	uint32_t PollUs;
+	uint32_t Length;
+	TraceRecord_t* Records;
+} Trace_t;
+
+// Function Prototypes
+// The tag for a firmware state.
+uint8_t Trace_Tag(const State_t State, const bool Correcting);
+// Name of a tag, like "MOVE" or "STOP+C".
+const char* Trace_TagName(const uint8_t Tag);
+// Write a trace. Open returns false if the file can't be created.
+bool Trace_Open(TraceWriter_t* const Writer, const char* const Path, const uint32_t PollUs);
+void Trace_Write(TraceWriter_t* const Writer, const TraceRecord_t* const Record);
+bool Trace_Close(TraceWriter_t* const Writer);
+// Read a whole trace, false if it can't be read or isn't one. Free it with Trace_Free.
+bool Trace_Load(Trace_t* const Trace, const char* const Path);
+void Trace_Free(Trace_t* const Trace);
+
+#endif
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+
+# Pacing autotuner: tries every combination of traversal strategy, echoes and sync delays on the
+# simulator under a fault profile, and writes the fastest one with no defects as Tuning.h.
+# Build the firmware with -DUSE_TUNING_HEADER to use it.
+
+import sys, os, getopt, itertools, tempfile
+from concurrent.futures import ThreadPoolExecutor
+import simlib, bench
+
+# Values tried for each firmware parameter. The simulator doesn't model the controller pairing,
+# so SYNC_CONTROLLER_MS is not tried below what has been seen to work on a console.
+PARAMETERS = [
+  ("MOVE_ECHOES", [1, 2, 3]),
+  ("STOP_ECHOES", [1, 2, 3]),
+  ("SYNC_CONTROLLER_MS", [1000, 1500, 2000]),
+  ("SYNC_POSITION_MS", [1500, 2000, 3000, 4000]),
+]
+
+def configurations(strategies):
+  names = [p[0] for p in PARAMETERS]
+  for strategy in strategies:
+    for values in itertools.product(*[p[1] for p in PARAMETERS]):
+      yield (strategy, tuple(zip(names, values)))
+
+def flags(config):
+  strategy, values = config
+  return " ".join([strategy[1]] + ["-D{}={}".format(n, v) for n, v in values]).strip()
+
+def build(job):
+  files, config, tmp = job
+  return simlib.build(tempfile.mkdtemp(dir=tmp), flags(config), **files)
+
+def run(job):
+  simulator, profile, seed = job
+  return simlib.run(simulator, ["-f", profile, "-s", str(seed)])
+
+# Print time of each configuration with no defects on any image and seed, None for the others.
+# The images go one at a time so the configurations that fail drop out early.
+def tune(images, configs, profile, seeds, tmp, pool):
+  times = {c: 0.0 for c in configs}
+  for image in images:
+    alive = [c for c in configs if times[c] is not None]
+    files = {s: simlib.prepare(image, s, tempfile.mkdtemp(dir=tmp)) for s in set(c[0] for c in alive)}
+    simulators = list(pool.map(build, [(files[c[0]], c, tmp) for c in alive]))
+    jobs = [(sim, profile, seed) for sim in simulators for seed in range(1, seeds + 1)]
+    results = list(pool.map(run, jobs))
+    for i, config in enumerate(alive):
+      runs = results[i * seeds:(i + 1) * seeds]
+      if any(r["errors"] > 0 for r in runs):
+        times[config] = None
+      else:
+        times[config] += sum(r["seconds"] for r in runs) / seeds
+    print("{}: {} of {} configurations left".format(simlib.image_name(image),
+      sum(1 for c in configs if times[c] is not None), len(configs)), file=sys.stderr)
+  return times
+
+def write_header(path, config, profile, seeds, images, minutes):
+  strategy, values = config
+  with open(path, 'w') as f:
+    f.write("/** \\file\n *\n")
+    f.write(" *  Pacing picked by sim/autotune.py: the fastest configuration with no defects on the\n")
+    f.write(" *  simulator under the \"{}\" fault profile ({} seeds), {:.1f} minutes per print on average\n".format(profile, seeds, minutes))
+    f.write(" *  over: {}.\n".format(", ".join(simlib.image_name(i) for i in images)))
+    f.write(" *  Generated file, run sim/autotune.py again rather than editing it.\n */\n\n")
+    f.write("#ifndef _TUNING_H_\n#define _TUNING_H_\n\n")
+    f.write("// Traversal strategy: {}\n".format(strategy[0]))
+    if len(strategy) > 2:
+      f.write("// Print with a plan: python3 plan2c.py -s {} <yourImage.png>\n".format(strategy[2]))
+    for flag in strategy[1].split():
+      name, _, value = flag[2:].partition("=")
+      f.write("#define {} {}\n".format(name, value).rstrip() + "\n")
+    for name, value in values:
+      f.write("#define {} {}\n".format(name, value))
+    f.write("\n#endif\n")
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hs:f:n:o:")
+  strategies = bench.STRATEGIES
+  profile = "handheld"
+  seeds = 3
+  out = os.path.join(simlib.REPO_DIR, "Tuning.h")
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-s':
+      strategies = [s for s in bench.STRATEGIES if s[0] == arg]
+    elif opt == '-f':
+      profile = arg
+    elif opt == '-n':
+      seeds = int(arg)
+    elif opt == '-o':
+      out = arg
+
+  images = args if args else bench.corpus()
+  configs = list(configurations(strategies))
+
+  with tempfile.TemporaryDirectory() as tmp, ThreadPoolExecutor(os.cpu_count()) as pool:
+    times = tune(images, configs, profile, seeds, tmp, pool)
+
+  passing = sorted((t, c) for c, t in times.items() if t is not None)
+  if not passing:
+    print("No configuration prints without defects under the {} fault profile".format(profile))
+    sys.exit(1)
+
+  print("{:<12} {:<70} {:>8}".format("strategy", "parameters", "minutes"))
+  for t, (strategy, values) in passing[:10]:
+    print("{:<12} {:<70} {:>8.1f}".format(strategy[0], " ".join("{}={}".format(n, v) for n, v in values), t / len(images) / 60))
+
+  t, best = passing[0]
+  write_header(out, best, profile, seeds, images, t / len(images) / 60)
+  print("Saved to " + out)
+
+def usage():
+  print("To tune on the whole corpus: autotune.py")
+  print("To tune on some images: autotune.py <yourImage.png> <other.data>")
+  print("To pick a strategy, a fault profile, the number of seeds or the output: autotune.py -s serpentine -f handheld -n 3 -o Tuning.h")
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+
+# Print-time benchmark: prints every image of the corpus with every traversal strategy and
+# pacing profile on the simulator, and shows how long it took and how exact the result is.
+
+import sys, os, glob, getopt, tempfile
+from concurrent.futures import ThreadPoolExecutor
+import simlib
+
+# Firmware flags for each traversal strategy, and for those that play back a plan, the
+# plan2c.py strategy it is compiled with
+STRATEGIES = [
+  ("serpentine", ""),
+  ("plan-spans", "", "spans"),
+  ("plan-anneal", "", "anneal"),
+]
+
+# Firmware flags for each pacing profile
+PACING = [
+  ("echoes=1", "-DECHOES=1"),
+  ("echoes=2", "-DECHOES=2"),
+  ("echoes=3", "-DECHOES=3"),
+]
+
+def corpus():
+  return [os.path.join(simlib.REPO_DIR, "splatoonpattern.png"),
+          os.path.join(simlib.REPO_DIR, "ironic.data")] + sorted(glob.glob(os.path.join(simlib.SIM_DIR, "corpus", "*")))
+
+def bench(job):
+  image, strategy, pacing, tmp = job
+  build_dir = tempfile.mkdtemp(dir=tmp)
+  simulator = simlib.build(build_dir, strategy[1] + " " + pacing[1], **simlib.prepare(image, strategy, build_dir))
+  return simlib.run(simulator)
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hs:p:")
+  strategies = STRATEGIES
+  pacing = PACING
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-s':
+      strategies = [s for s in STRATEGIES if s[0] == arg]
+    elif opt == '-p':
+      pacing = [p for p in PACING if p[0] == arg]
+
+  images = args if args else corpus()
+
+  with tempfile.TemporaryDirectory() as tmp:
+    jobs = [(i, s, p, tmp) for i in images for s in strategies for p in pacing]
+    with ThreadPoolExecutor(os.cpu_count()) as pool:
+      results = list(pool.map(bench, jobs))
+
+  print("{:<18} {:<12} {:<10} {:>9} {:>8} {:>9}".format("image", "strategy", "pacing", "reports", "minutes", "exact"))
+  for (image, strategy, pace, _), r in zip(jobs, results):
+    exact = 100.0 * (1 - r["errors"] / (simlib.WIDTH * simlib.HEIGHT))
+    print("{:<18} {:<12} {:<10} {:>9} {:>8.1f} {:>8.2f}%".format(
+      simlib.image_name(image), strategy[0], pace[0], int(r["reports"]), r["seconds"] / 60, exact))
+
+def usage():
+  print("To benchmark the whole corpus: bench.py")
+  print("To benchmark some images: bench.py <yourImage.png> <other.data>")
+  print("To pick a strategy or pacing profile: bench.py -s serpentine -p echoes=2")
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+
+# Fault-injection run: prints every image of the corpus with every traversal strategy under
+# every fault profile of the simulator (see Faults.c), with several seeds, and shows how many
+# pixels and rows came out wrong.
+
+import sys, os, getopt, tempfile
+from concurrent.futures import ThreadPoolExecutor
+import simlib, bench
+
+PROFILES = ["none", "handheld", "docked", "bad-dock"]
+
+def build(job):
+  image, strategy, tmp = job
+  build_dir = tempfile.mkdtemp(dir=tmp)
+  return simlib.build(build_dir, strategy[1], **simlib.prepare(image, strategy, build_dir))
+
+def run(job):
+  simulator, profile, seed = job
+  return simlib.run(simulator, ["-f", profile, "-s", str(seed)])
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hs:f:n:")
+  strategies = bench.STRATEGIES
+  profiles = PROFILES
+  seeds = 4
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-s':
+      strategies = [s for s in bench.STRATEGIES if s[0] == arg]
+    elif opt == '-f':
+      profiles = [arg]
+    elif opt == '-n':
+      seeds = int(arg)
+
+  images = args if args else bench.corpus()
+
+  with tempfile.TemporaryDirectory() as tmp, ThreadPoolExecutor(os.cpu_count()) as pool:
+    builds = [(i, s, tmp) for i in images for s in strategies]
+    simulators = list(pool.map(build, builds))
+    jobs = [(sim, p, seed) for sim in simulators for p in profiles for seed in range(1, seeds + 1)]
+    results = list(pool.map(run, jobs))
+
+  print("{:<18} {:<12} {:<10} {:>8} {:>11} {:>11} {:>9}".format(
+    "image", "strategy", "faults", "minutes", "defects", "worst", "rows"))
+  for b, (image, strategy, _) in enumerate(builds):
+    for p, profile in enumerate(profiles):
+      runs = results[(b * len(profiles) + p) * seeds:(b * len(profiles) + p + 1) * seeds]
+      minutes = sum(r["seconds"] for r in runs) / len(runs) / 60
+      defects = sum(r["errors"] for r in runs) / len(runs)
+      worst = max(r["errors"] for r in runs)
+      rows = max(r["rows"] for r in runs)
+      print("{:<18} {:<12} {:<10} {:>8.1f} {:>11.1f} {:>11} {:>9}".format(
+        simlib.image_name(image), strategy[0], profile, minutes, defects, int(worst), int(rows)))
+
+def usage():
+  print("To run the whole corpus under every fault profile: faults.py")
+  print("To run some images: faults.py <yourImage.png> <other.data>")
+  print("To pick a strategy, a fault profile or the number of seeds: faults.py -s serpentine -f docked -n 8")
+  print("defects is the mean number of wrong pixels over the seeds, worst and rows the worst seed")
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
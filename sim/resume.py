@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+
+# Resume check: prints an image through each way the firmware resumes a print, dropping the USB
+# connection (simulator -d) at many points of the print, and fails if any print comes out
+# wrong. Half of the drops are spread over the print, the other half land in the echoes of A
+# and B presses (found in a trace of the print), so a press cut off half way is caught. A queue
+# also gets a drop in the echoes of every press of the sequence that saves a post. A few runs
+# drop again in the echoes of the first press after the resume, which is the cut off press sent
+# again when the print resumes from it.
+#
+# The prints that save a checkpoint to EEPROM also get their power cut (simulator -R) a few
+# times, over the print and right after presses. The print then starts again on the canvas and
+# with the EEPROM it was cut off with, and must come out right without starting over.
+
+import sys, os, getopt, tempfile, subprocess
+import simlib, planview
+
+# Single drops spread over each print, the drops of one run with several of them, and the runs
+# dropping twice in a press
+DROPS = 100
+SPREAD = 3
+DOUBLE = 4
+# Power cuts over each print and right after presses, for the cases that save checkpoints
+POWER_CUTS = 3
+CHECKPOINTED = ("serpentine", "plan-spans", "queue")
+# Simulator poll interval, in s (POLLING_MS)
+POLL = 0.008
+
+# Each case is a name and a function that builds the simulator for an image into a directory
+def serpentine(image, directory):
+  return simlib.build(directory, "", **simlib.prepare(image, ("serpentine", ""), directory))
+
+def plan(image, directory):
+  return simlib.build(directory, "", **simlib.prepare(image, ("plan-spans", "", "spans"), directory))
+
+# Patch of the black pixels, on the blank canvas the simulator starts from
+def patch(image, directory):
+  files = simlib.prepare(image, ("serpentine", ""), directory)
+  subprocess.run([sys.executable, os.path.join(simlib.REPO_DIR, "patch2c.py"), os.path.abspath(image)],
+                 cwd=directory, check=True, stdout=subprocess.DEVNULL)
+  return simlib.build(directory, "", patch_c=os.path.join(directory, "patch.c"), **files)
+
+# scripts/spans.script, which syncs again with its .resync handler
+def script(image, directory):
+  files = simlib.prepare(image, ("serpentine", ""), directory)
+  script_c = os.path.join(directory, "script.c")
+  subprocess.run([sys.executable, os.path.join(simlib.REPO_DIR, "script2c.py"), "-o", script_c,
+                  os.path.join(simlib.REPO_DIR, "scripts", "spans.script")], check=True, stdout=subprocess.DEVNULL)
+  return simlib.build(directory, "-DSCRIPT_VM", script_c=script_c, **files)
+
+# The image then text.png, printed as a queue of two posts
+def queue(image, directory):
+  subprocess.run([sys.executable, os.path.join(simlib.REPO_DIR, "queue2c.py"), os.path.abspath(image),
+                  os.path.join(simlib.SIM_DIR, "corpus", "text.png")], cwd=directory, check=True, stdout=subprocess.DEVNULL)
+  return simlib.build(directory, "", image_c=os.path.join(directory, "image.c"),
+                      queue_c=os.path.join(directory, "queue.c"))
+
+CASES = [
+  ("serpentine", serpentine),
+  ("plan-spans", plan),
+  ("patch", patch),
+  ("script", script),
+  ("queue", queue),
+]
+
+# Times of the A and B presses of a print, and of the presses that save a queued post, in s
+def press_times(simulator, tmp, drops=()):
+  trace = os.path.join(tmp, "resume.trace")
+  simlib.run(simulator, ["-t", trace] + (["-d", ",".join(map(str, drops))] if drops else []))
+  records, _ = planview.read_trace(trace)
+  buttons = planview.SWITCH_A | planview.SWITCH_B
+  edges = [(t / 1e6, button, tag) for (t, button, *_, tag), (_, last, *_) in zip(records[1:], records)
+           if button and button != last]
+  return ([t for t, button, tag in edges if button & buttons and (tag & 0x7F) != planview.TRACE_TAG_QUEUE],
+          [t for t, button, tag in edges if (tag & 0x7F) == planview.TRACE_TAG_QUEUE])
+
+# Drop times over a print: single drops spread over it and right after presses, one or two
+# polls in, then one run with SPREAD drops and runs with drops in each press that saves a post
+def drop_runs(seconds, presses, saves):
+  runs = [[round(seconds * (i + 0.5) / (DROPS // 2) + (i % 3) * POLL, 3)] for i in range(DROPS // 2)]
+  picked = presses[len(presses) // (2 * (DROPS // 2))::max(1, len(presses) // (DROPS // 2))][:DROPS // 2]
+  runs += [[round(t + (1 + i % 2) * POLL, 3)] for i, t in enumerate(picked)]
+  runs.append([round(seconds * (i + 1) / (SPREAD + 1), 3) for i in range(SPREAD)])
+  runs += [[round(t + n * POLL, 3)] for t in saves for n in (1, 2)]
+  return runs
+
+# Runs dropping in a press, then again in the first press after the resume
+def double_drop_runs(simulator, tmp, presses):
+  runs = []
+  for t in presses[len(presses) // (2 * DOUBLE)::max(1, len(presses) // DOUBLE)][:DOUBLE]:
+    drop = round(t + POLL, 3)
+    again = [p for p in press_times(simulator, tmp, [drop])[0] if p > drop]
+    if again:
+      runs.append([drop, round(again[0] + POLL, 3)])
+  return runs
+
+# Power cut times: spread over the print, then one or two polls after presses. The spread ones
+# land just before the nearest press, inside an image: a reset between two posts of a queue
+# starts it over (the post may have been saved).
+def power_cuts(seconds, presses):
+  if not presses:
+    return []
+  spread = [min(presses, key=lambda t: abs(t - seconds * (i + 1) / (POWER_CUTS + 1))) for i in range(POWER_CUTS)]
+  cuts = [round(t - 2 * POLL, 3) for t in spread]
+  picked = presses[len(presses) // (2 * POWER_CUTS)::max(1, len(presses) // POWER_CUTS)][:POWER_CUTS]
+  return cuts + [round(t + (1 + i % 2) * POLL, 3) for i, t in enumerate(picked)]
+
+# Cut the power at a time, then print again from what was left on the canvas and in EEPROM
+def power_cut_run(simulator, tmp, cut):
+  eeprom = os.path.join(tmp, "resume.eeprom")
+  canvas = os.path.join(tmp, "resume.data")
+  if os.path.exists(eeprom):
+    os.remove(eeprom)
+  simlib.run(simulator, ["-R", str(cut), "-e", eeprom, "-D", canvas])
+  return simlib.run(simulator, ["-c", canvas, "-e", eeprom])
+
+def check(name, build, image, tmp):
+  simulator = build(image, tempfile.mkdtemp(dir=tmp))
+  clean = simlib.run(simulator)
+  seconds = clean["seconds"]
+  failed = []
+  presses, saves = press_times(simulator, tmp)
+  runs = drop_runs(seconds, presses, saves) + double_drop_runs(simulator, tmp, presses)
+  for drops in runs:
+    r = simlib.run(simulator, ["-d", ",".join(map(str, drops))])
+    # A queue must still print all its posts
+    if r["errors"] or r["posts"] != clean["posts"]:
+      failed.append(("drops at {} s".format(",".join(map(str, drops))), int(r["errors"])))
+  cuts = power_cuts(seconds, presses) if name in CHECKPOINTED else []
+  for cut in cuts:
+    r = power_cut_run(simulator, tmp, cut)
+    # Starting over would take as long as the whole print
+    if r["errors"] or r["seconds"] >= seconds:
+      failed.append(("power cut at {} s{}".format(cut, ", started over" if r["seconds"] >= seconds else ""),
+                     int(r["errors"])))
+  return seconds, len(runs) + len(cuts), failed
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hc:")
+  cases = CASES
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-c':
+      cases = [c for c in CASES if c[0] == arg]
+
+  image = args[0] if args else os.path.join(simlib.SIM_DIR, "corpus", "lineart.png")
+  ok = True
+  print("{:<14} {:>8} {:>6} {:>7}  {}".format("case", "minutes", "runs", "failed", "first failure"))
+  with tempfile.TemporaryDirectory() as tmp:
+    for name, build in cases:
+      seconds, runs, failed = check(name, build, image, tmp)
+      first = "{}: {} pixels wrong".format(*failed[0]) if failed else ""
+      print("{:<14} {:>8.1f} {:>6} {:>7}  {}".format(name, seconds / 60, runs, len(failed), first))
+      ok &= not failed
+  sys.exit(0 if ok else 1)
+
+def usage():
+  print("To check every resume path on lineart.png: resume.py")
+  print("To check one path on your image: resume.py -c serpentine <yourImage.png>")
+  print("The cases are: " + ", ".join(c[0] for c in CASES))
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
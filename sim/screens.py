@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+
+# Screenshot check: draws synthetic captures of the canvas, at several sizes and offsets on a
+# 1280x720 screen, blurred like a capture and with a few wrong pixels, and checks that
+# screen2c.py finds the canvas within a canvas pixel and reads back exactly the wrong pixels.
+
+import sys, os, getopt
+import numpy as np
+import simlib, bench
+import screen2c
+
+SCREEN = (720, 1280)
+# Screen pixels per canvas pixel, about 3 in a capture of the Switch, which holds up to 4
+SCALES = [2.0, 2.25, 2.5, 2.75, 3.0, 3.25, 3.5]
+# Wrong pixels drawn on each capture
+WRONG = 12
+# Off by more than this, in screen pixels, the canvas is not found (less than a canvas pixel, a
+# placement anywhere within the cells reads the same)
+TOLERANCE = 1.5
+# Screen level around the canvas, of the ink and of the blank canvas
+BACKGROUND, INK, BLANK = 0.35, 0.05, 0.95
+
+# The canvas at (x0, y0), scale screen pixels per canvas pixel, each screen pixel taking the level
+# of the cell its centre falls in, then blurred with its 4 neighbours
+def capture(canvas, x0, y0, scale):
+  ys, xs = np.mgrid[0:SCREEN[0], 0:SCREEN[1]]
+  cx = np.floor((xs + 0.5 - x0) / scale).astype(int)
+  cy = np.floor((ys + 0.5 - y0) / scale).astype(int)
+  inside = (cx >= 0) & (cx < simlib.WIDTH) & (cy >= 0) & (cy < simlib.HEIGHT)
+  screen = np.full(SCREEN, BACKGROUND)
+  screen[inside] = np.where(canvas[cy[inside], cx[inside]], INK, BLANK)
+  p = np.pad(screen, 1, mode='edge')
+  return (p[:-2, 1:-1] + p[2:, 1:-1] + p[1:-1, :-2] + p[1:-1, 2:] + 4 * screen) / 8
+
+# Capture one image at one scale, returns how far off the canvas was found, in screen pixels,
+# and how many wrong pixels were missed or made up
+def check(target, scale, rng):
+  x0 = rng.uniform(0, SCREEN[1] - simlib.WIDTH * scale)
+  y0 = rng.uniform(0, SCREEN[0] - simlib.HEIGHT * scale)
+  canvas = target.copy()
+  wrong = rng.choice(target.size, WRONG, replace=False)
+  canvas.flat[wrong] = ~canvas.flat[wrong]
+
+  screen = capture(canvas, x0, y0, scale)
+  fx0, fy0, fscale = screen2c.register(screen, target)
+  off = max(abs(fx0 - x0), abs(fy0 - y0), abs(fx0 + simlib.WIDTH * fscale - x0 - simlib.WIDTH * scale),
+            abs(fy0 + simlib.HEIGHT * fscale - y0 - simlib.HEIGHT * scale))
+  read, _, _ = screen2c.read_canvas(screen, target, fx0, fy0, fscale)
+  return off, int((read != canvas).sum())
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hs:")
+  scales = SCALES
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-s':
+      scales = [float(arg)]
+
+  images = args if args else bench.corpus()
+  rng = np.random.default_rng(1)
+  ok = True
+  print("{:<16} {:>6} {:>8} {:>8}".format("image", "scale", "off px", "misread"))
+  for image in images:
+    target = simlib.load_image(image).astype(bool)
+    # A blank or full canvas has nothing to find it by
+    if not target.any() or target.all():
+      continue
+    for scale in scales:
+      off, misread = check(target, scale, rng)
+      failed = off > TOLERANCE or misread > 0
+      print("{:<16} {:>6.2f} {:>8.2f} {:>8}{}".format(simlib.image_name(image), scale, off, misread,
+                                                      "  FAILED" if failed else ""))
+      ok &= not failed
+  sys.exit(0 if ok else 1)
+
+def usage():
+  print("To check that screen2c.py finds the canvas at every scale: screens.py")
+  print("To check one scale on your image: screens.py -s 3.0 <yourImage.png>")
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
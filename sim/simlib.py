@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+
+# Helpers shared by the simulator scripts: loading images, building and running the simulator.
+
+import os, sys, subprocess
+
+WIDTH = 320
+HEIGHT = 120
+SIM_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(SIM_DIR)
+
+sys.path.insert(0, REPO_DIR)
+import imagelib, plan2c
+
+# Load a 320x120 .png (black pixels are inked, like png2c.py) or a .data file with one byte per
+# pixel (non-zero bytes are inked, like bin2c.py), as a HEIGHT x WIDTH array of 1 and 0
+def load_image(path, invert=False):
+  return imagelib.load(path, invert).astype(int)
+
+image_name = imagelib.image_name
+
+# Write bits as image.c, in the same format as png2c.py
+write_image_c = imagelib.write_image_c
+
+# Write image.c for an image into directory, and plan.c when the strategy (see bench.STRATEGIES)
+# plays back a plan compiled by plan2c.py. Returns them as keyword arguments of build().
+def prepare(image, strategy, directory):
+  bits = imagelib.load(image)
+  files = {"image_c": os.path.join(directory, "image.c")}
+  write_image_c(bits, files["image_c"])
+  if len(strategy) > 2:
+    files["plan_c"] = os.path.join(directory, "plan.c")
+    plan2c.write_plan(plan2c.compile_plan(bits, strategy[2])[1], files["plan_c"])
+  return files
+
+# Build the simulator into build_dir with the given firmware flags, image.c, patch.c, plan.c,
+# script.c and queue.c
+def build(build_dir, flags="", image_c=None, patch_c=None, plan_c=None, script_c=None, queue_c=None):
+  cmd = ["make", "-s", "-C", SIM_DIR, "simulator", "BUILD=" + os.path.abspath(build_dir), "FLAGS=" + flags]
+  if image_c:
+    cmd.append("IMAGE=" + os.path.abspath(image_c))
+  if patch_c:
+    cmd.append("PATCH=" + os.path.abspath(patch_c))
+  if plan_c:
+    cmd.append("PLAN=" + os.path.abspath(plan_c))
+  if script_c:
+    cmd.append("SCRIPT=" + os.path.abspath(script_c))
+  if queue_c:
+    cmd.append("QUEUE=" + os.path.abspath(queue_c))
+  subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL)
+  return os.path.join(build_dir, "simulator")
+
+# Run a simulator build, returns its key=value summary as a dict of numbers
+def run(simulator, args=()):
+  out = subprocess.run([simulator, "-q", "-o", os.devnull] + list(args), check=True,
+                       stdout=subprocess.PIPE, universal_newlines=True).stdout
+  result = {}
+  for field in out.split():
+    key, value = field.split("=", 1)
+    result[key] = float(value)
+  return result
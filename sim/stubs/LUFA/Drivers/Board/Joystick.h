@@ -0,0 +1 @@
+// Host stand-in, no board drivers are used.
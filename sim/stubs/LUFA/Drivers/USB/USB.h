@@ -0,0 +1,68 @@
+// Host stand-in for the parts of the LUFA USB driver the firmware uses.
+// The endpoint functions are implemented by the simulated host in Simulator.c.
+#ifndef _SIM_USB_H_
+#define _SIM_USB_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ATTR_WARN_UNUSED_RESULT
+#define ATTR_NON_NULL_PTR_ARG(...)
+#define ATTR_PACKED __attribute__((packed))
+
+#define ENDPOINT_DIR_IN   0x80
+#define ENDPOINT_DIR_OUT  0x00
+#define EP_TYPE_INTERRUPT 0x03
+
+#define REQDIR_DEVICETOHOST (1 << 7)
+#define REQTYPE_CLASS       (1 << 5)
+#define REQREC_INTERFACE    1
+#define HID_REQ_GetReport   0x01
+
+#define GlobalInterruptEnable()
+
+enum USB_Device_States_t
+{
+	DEVICE_STATE_Unattached = 0,
+	DEVICE_STATE_Powered    = 1,
+	DEVICE_STATE_Default    = 2,
+	DEVICE_STATE_Addressed  = 3,
+	DEVICE_STATE_Configured = 4,
+	DEVICE_STATE_Suspended  = 5,
+};
+
+// Descriptors are not used on the host, these only need to exist.
+typedef struct { uint8_t Unused; } USB_Descriptor_Configuration_Header_t;
+typedef struct { uint8_t Unused; } USB_Descriptor_Interface_t;
+typedef struct { uint8_t Unused; } USB_HID_Descriptor_HID_t;
+typedef struct { uint8_t Unused; } USB_Descriptor_Endpoint_t;
+
+typedef struct
+{
+	uint8_t  bmRequestType;
+	uint8_t  bRequest;
+	uint16_t wValue;
+	uint16_t wIndex;
+	uint16_t wLength;
+} USB_Request_Header_t;
+
+extern volatile uint8_t USB_DeviceState;
+extern USB_Request_Header_t USB_ControlRequest;
+
+void USB_Init(void);
+void USB_USBTask(void);
+
+bool Endpoint_ConfigureEndpoint(const uint8_t Address, const uint8_t Type, const uint16_t Size, const uint8_t Banks);
+void Endpoint_SelectEndpoint(const uint8_t Address);
+bool Endpoint_IsOUTReceived(void);
+bool Endpoint_IsINReady(void);
+bool Endpoint_IsReadWriteAllowed(void);
+uint8_t Endpoint_Read_Stream_LE(void* const Buffer, uint16_t Length, uint16_t* const BytesProcessed);
+uint8_t Endpoint_Write_Stream_LE(const void* const Buffer, uint16_t Length, uint16_t* const BytesProcessed);
+void Endpoint_ClearOUT(void);
+void Endpoint_ClearIN(void);
+void Endpoint_ClearSETUP(void);
+uint8_t Endpoint_Write_Control_Stream_LE(const void* const Buffer, uint16_t Length);
+
+#endif
@@ -0,0 +1 @@
+// Host stand-in, no platform drivers are used.
@@ -0,0 +1,18 @@
+// Host stand-in for avr-libc's eeprom.h: EEMEM variables live in RAM, all in one section the
+// simulator saves and loads as the EEPROM (-e).
+#ifndef _SIM_EEPROM_H_
+#define _SIM_EEPROM_H_
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __APPLE__
+#define EEMEM __attribute__((section("__DATA,sim_eeprom")))
+#else
+#define EEMEM __attribute__((section("sim_eeprom")))
+#endif
+
+static inline void eeprom_read_block(void* dst, const void* src, size_t n) { memcpy(dst, src, n); }
+static inline void eeprom_update_block(const void* src, void* dst, size_t n) { memcpy(dst, src, n); }
+
+#endif
@@ -0,0 +1,9 @@
+// Host stand-in for avr-libc's interrupt.h.
+#ifndef _SIM_INTERRUPT_H_
+#define _SIM_INTERRUPT_H_
+
+#define sei()
+#define cli()
+#define ISR(Vector) void Vector(void)
+
+#endif
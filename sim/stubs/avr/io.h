@@ -0,0 +1,39 @@
+// Host stand-in for avr-libc's io.h.
+#ifndef _SIM_IO_H_
+#define _SIM_IO_H_
+
+#include <stdint.h>
+
+extern uint8_t MCUSR;
+#define WDRF 3
+
+// Timer1, run from the simulated time by Simulator.c
+extern uint8_t SREG;
+extern uint8_t TCCR1A;
+extern uint8_t TCCR1B;
+extern uint8_t TIMSK1;
+extern uint8_t TIFR1;
+extern uint16_t TCNT1;
+#define CS11  1
+#define TOIE1 0
+#define TOV1  0
+
+// USART1, drained by Simulator.c
+extern uint16_t UBRR1;
+extern uint8_t UCSR1A;
+extern uint8_t UCSR1B;
+extern uint8_t UCSR1C;
+extern uint8_t UDR1;
+#define U2X1   1
+#define UCSZ10 1
+#define UCSZ11 2
+#define TXEN1  3
+#define UDRIE1 5
+
+// PORTB, for the queue trigger (held down in the simulator)
+extern uint8_t PINB;
+extern uint8_t DDRB;
+extern uint8_t PORTB;
+#define PB1 1
+
+#endif
@@ -0,0 +1,14 @@
+// Host stand-in for avr-libc's pgmspace.h: flash is plain memory on the host.
+#ifndef _SIM_PGMSPACE_H_
+#define _SIM_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define memcpy_P memcpy
+
+#endif
@@ -0,0 +1,8 @@
+// Host stand-in for avr-libc's power.h.
+#ifndef _SIM_POWER_H_
+#define _SIM_POWER_H_
+
+#define clock_div_1 0
+#define clock_prescale_set(div)
+
+#endif
@@ -0,0 +1,7 @@
+// Host stand-in for avr-libc's wdt.h.
+#ifndef _SIM_WDT_H_
+#define _SIM_WDT_H_
+
+#define wdt_disable()
+
+#endif
@@ -0,0 +1,23 @@
+// Host stand-in for avr-libc's crc16.h, same polynomials as the AVR versions.
+#ifndef _SIM_CRC16_H_
+#define _SIM_CRC16_H_
+
+#include <stdint.h>
+
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t a)
+{
+	crc ^= a;
+	for (int i = 0; i < 8; i++)
+		crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+	return crc;
+}
+
+static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data)
+{
+	data ^= crc;
+	for (int i = 0; i < 8; i++)
+		data = (data & 0x80) ? (data << 1) ^ 0x07 : (data << 1);
+	return data;
+}
+
+#endif
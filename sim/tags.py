@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+
+# Trace tag check: records a print and checks that replay splits its time by report kind. Every
+# D-pad report of the print is tagged MOVE and every other one STOP, echoes included, so the
+# MOVE time replay shows is the time the D-pad was held.
+
+import sys, os, getopt, tempfile, subprocess
+import simlib, planview
+
+# Each case is a name and the strategy it prints with (see bench.STRATEGIES)
+CASES = [
+  ("serpentine", ("serpentine", "")),
+  ("plan-spans", ("plan-spans", "", "spans")),
+]
+TAGS = (planview.TRACE_TAG_MOVE, planview.TRACE_TAG_STOP)
+
+# Seconds per tag as replay prints them
+def replay_times(trace):
+  out = subprocess.run([os.path.join(simlib.SIM_DIR, "replay"), trace], check=True,
+                       stdout=subprocess.PIPE, universal_newlines=True).stdout
+  times = {}
+  for line in out.splitlines():
+    fields = line.split()
+    if len(fields) == 2 and fields[1].endswith("s") and fields[0].isupper():
+      times[fields[0]] = float(fields[1][:-1])
+  return times
+
+def check(strategy, image, tmp):
+  directory = tempfile.mkdtemp(dir=tmp)
+  simulator = simlib.build(directory, strategy[1], **simlib.prepare(image, strategy, directory))
+  trace = os.path.join(directory, "tags.trace")
+  simlib.run(simulator, ["-t", trace])
+  records, _ = planview.read_trace(trace)
+
+  held = {tag: 0 for tag in TAGS}
+  wrong = 0
+  for (t, button, hat, *_, tag), (next_t, *_) in zip(records, records[1:]):
+    tag &= 0x7F
+    if tag not in TAGS:
+      continue
+    dpad = hat != planview.HAT_CENTER
+    held[planview.TRACE_TAG_MOVE if dpad else planview.TRACE_TAG_STOP] += next_t - t
+    wrong += dpad != (tag == planview.TRACE_TAG_MOVE)
+  times = replay_times(trace)
+  return wrong, held[planview.TRACE_TAG_MOVE] / 1e6, times.get("MOVE", 0), held[planview.TRACE_TAG_STOP] / 1e6, times.get("STOP", 0)
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "h")
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+
+  image = args[0] if args else os.path.join(simlib.SIM_DIR, "corpus", "lineart.png")
+  subprocess.run(["make", "-s", "-C", simlib.SIM_DIR, "replay"], check=True)
+  ok = True
+  print("{:<12} {:>7} {:>9} {:>9} {:>9} {:>9}".format("case", "wrong", "D-pad s", "MOVE s", "other s", "STOP s"))
+  with tempfile.TemporaryDirectory() as tmp:
+    for name, strategy in CASES:
+      wrong, dpad, move, other, stop = check(strategy, image, tmp)
+      # replay rounds to 0.1 s
+      failed = wrong > 0 or abs(dpad - move) > 0.05 or abs(other - stop) > 0.05
+      print("{:<12} {:>7} {:>9.1f} {:>9.1f} {:>9.1f} {:>9.1f}{}".format(name, wrong, dpad, move, other, stop,
+                                                                      "  FAILED" if failed else ""))
+      ok &= not failed
+  sys.exit(0 if ok else 1)
+
+def usage():
+  print("To check the tags of a print of lineart.png: tags.py")
+  print("To check them on your image: tags.py <yourImage.png>")
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+
+# Print-time budget for png2c.py: removes the pixels that cost the most time for what they add
+# to the image, until printing the inked pixels as a patch fits in the given time.
+#
+# The patch route (see imagelib.patch_route_steps) crosses each row from its first to its last
+# inked pixel, so its length only depends on where the ink starts and ends on every row.
+# Pixels inside those bounds are free, and filling the gap between two runs saves nothing.
+# What costs time are the specks and small shapes that push a row's bounds out, and the short
+# runs at the ends of rows. They are the candidate edits, ranked by time saved per pixel removed.
+
+import numpy as np
+import imagelib
+
+# Largest component (8-connected) and end-of-row run that may be removed, in pixels
+MAX_COMPONENT = 32
+MAX_END_RUN = 8
+
+# Steps of the patch route from the first and last inked x of every row (-1 for empty rows).
+# The same as imagelib.patch_route_steps, without visiting the pixels.
+def route_steps(first, last):
+  ys = np.nonzero(first >= 0)[0]
+  if ys.size == 0:
+    return 0
+  even = ys % 2 == 0
+  entry = np.where(even, first[ys], last[ys])
+  exit = np.where(even, last[ys], first[ys])
+  steps = int((last[ys] - first[ys]).sum())
+  steps += int(np.abs(entry - np.concatenate(([0], exit[:-1]))).sum() + ys[-1])
+  return steps + (1 if ys[0] == 0 and entry[0] == 0 else 0)
+
+def extents(bits):
+  inked = bits.any(axis=1)
+  first = np.where(inked, bits.argmax(axis=1), -1)
+  last = np.where(inked, bits.shape[1] - 1 - bits[:, ::-1].argmax(axis=1), -1)
+  return first, last
+
+# Small connected components of inked pixels that reach the first or last x of a row (the
+# others cannot change the route), as lists of (y, x)
+def components(bits, max_size):
+  seen = np.zeros(bits.shape, dtype=bool).tolist()
+  h, w = bits.shape
+  inked = bits.tolist()
+  first, last = extents(bits)
+  found = []
+  for y0 in np.nonzero(first >= 0)[0]:
+    for x0 in (first[y0], last[y0]):
+      if seen[y0][x0]:
+        continue
+      seen[y0][x0] = True
+      stack = [(y0, x0)]
+      pixels = []
+      while stack and len(pixels) <= max_size:
+        y, x = stack.pop()
+        pixels.append((y, x))
+        for ny in (y - 1, y, y + 1):
+          for nx in (x - 1, x, x + 1):
+            if 0 <= ny < h and 0 <= nx < w and inked[ny][nx] and not seen[ny][nx]:
+              seen[ny][nx] = True
+              stack.append((ny, nx))
+      if len(pixels) <= max_size:
+        found.append(pixels)
+  return found
+
+# The first and last run of every row, when they are short
+def end_runs(bits, max_length):
+  found = []
+  first, last = extents(bits)
+  for y in np.nonzero(first >= 0)[0]:
+    row = bits[y]
+    x = first[y]
+    while x <= last[y] and row[x] and x - first[y] < max_length:
+      x += 1
+    if x > last[y] or not row[x]:
+      found.append([(y, i) for i in range(first[y], x)])
+    x = last[y]
+    while x >= first[y] and row[x] and last[y] - x < max_length:
+      x -= 1
+    if x >= first[y] and not row[x]:
+      found.append([(y, i) for i in range(x + 1, last[y] + 1)])
+  return found
+
+# Steps saved by removing the pixels, only the rows they are on can change bounds
+def saving(bits, first, last, pixels, steps):
+  if not any(x == first[y] or x == last[y] for y, x in pixels):
+    return 0
+  rows = sorted(set(y for y, _ in pixels))
+  f = first.copy()
+  l = last.copy()
+  for y, x in pixels:
+    bits[y, x] = False
+  for y in rows:
+    row = bits[y]
+    if row.any():
+      f[y] = row.argmax()
+      l[y] = len(row) - 1 - row[::-1].argmax()
+    else:
+      f[y] = l[y] = -1
+  for y, x in pixels:
+    bits[y, x] = True
+  return steps - route_steps(f, l)
+
+# Remove pixels from bits until the patch of its inked pixels prints in max_seconds. Returns the
+# simplified bits and how many pixels were removed; it may not fit if max_seconds is too short.
+def fit(bits, max_seconds):
+  bits = bits.copy()
+  max_steps = (max_seconds - imagelib.SYNC_SECONDS) / imagelib.SECONDS_PER_STEP
+  removed = 0
+
+  while True:
+    first, last = extents(bits)
+    steps = route_steps(first, last)
+    if steps <= max_steps:
+      break
+
+    candidates = components(bits, MAX_COMPONENT) + end_runs(bits, MAX_END_RUN)
+    ranked = []
+    for pixels in candidates:
+      saved = saving(bits, first, last, pixels, steps)
+      if saved > 0:
+        ranked.append((saved / len(pixels), pixels))
+    if not ranked:
+      break
+
+    # Best first, each edit is checked again since those before it may have moved the bounds
+    ranked.sort(key=lambda c: -c[0])
+    applied = 0
+    for ratio, pixels in ranked:
+      if any(not bits[y, x] for y, x in pixels):
+        continue
+      saved = saving(bits, first, last, pixels, steps)
+      if saved <= 0 or saved / len(pixels) < ratio / 2:
+        continue
+      for y, x in pixels:
+        bits[y, x] = False
+      removed += len(pixels)
+      applied += 1
+      first, last = extents(bits)
+      steps = route_steps(first, last)
+      if steps <= max_steps:
+        break
+    if applied == 0:
+      break
+
+  return bits, removed
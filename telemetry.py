@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+
+# Decode the telemetry of a printer built with -DUART_TELEMETRY, live from a serial port (a USB
+# to serial adapter on pin 0 of the UNO) or from a file saved by the simulator (-u).
+
+import sys, os, getopt, struct, termios
+
+SYNC = 0xA5
+START, ROW, STATE, LAG, DISCONNECT, DROPPED = range(1, 7)
+FLAGS = [(0x01, "resuming"), (0x02, "correction"), (0x04, "patch"), (0x08, "plan"), (0x10, "script"), (0x20, "queue")]
+STATES = ["SYNC_CONTROLLER", "SYNC_POSITION", "RESUME_POSITION", "BULK_ERASE", "PRINTING", "STOP", "DONE", "SCRIPT", "QUEUE"]
+ROWS = 120
+
+def crc8(data):
+  # _crc8_ccitt_update from avr-libc
+  crc = 0
+  for b in data:
+    crc ^= b
+    for _ in range(8):
+      crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+  return crc
+
+# Yields (type, time in ms, payload) for every good frame, skipping whatever doesn't check out
+def frames(stream):
+  buf = bytearray()
+  while True:
+    chunk = stream.read(256)
+    if not chunk:
+      return
+    buf += chunk
+    while True:
+      start = buf.find(SYNC)
+      if start < 0:
+        buf.clear()
+        break
+      del buf[:start]
+      if len(buf) < 3 or len(buf) < 3 + 4 + buf[2] + 1:
+        break
+      length = buf[2]
+      frame = bytes(buf[:3 + 4 + length + 1])
+      if crc8(frame[1:-1]) != frame[-1]:
+        del buf[:1]
+        continue
+      del buf[:len(frame)]
+      yield frame[1], struct.unpack_from("<I", frame, 3)[0], frame[7:-1]
+
+def clock(ms):
+  return "{:3d}:{:02d}.{:03d}".format(ms // 60000, ms // 1000 % 60, ms % 1000)
+
+def open_port(path, baud):
+  fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+  attrs = termios.tcgetattr(fd)
+  speed = getattr(termios, "B" + str(baud))
+  attrs[0] = 0                                          # iflag
+  attrs[1] = 0                                          # oflag
+  attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+  attrs[3] = 0                                          # lflag
+  attrs[4] = attrs[5] = speed
+  attrs[6][termios.VMIN] = 1
+  attrs[6][termios.VTIME] = 0
+  termios.tcsetattr(fd, termios.TCSANOW, attrs)
+  return os.fdopen(fd, "rb", buffering=0)
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hb:")
+  baud = 115200
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-b':
+      baud = int(arg)
+
+  if len(args) != 1:
+    usage()
+    sys.exit(1)
+
+  stream = open(args[0], "rb") if os.path.isfile(args[0]) else open_port(args[0], baud)
+  row_ms = []
+  lags = 0
+  try:
+    for kind, ms, payload in frames(stream):
+      if kind == START:
+        flags = [name for bit, name in FLAGS if payload[0] & bit]
+        print("{}  start {}".format(clock(ms), " ".join(flags) if flags else "printing"))
+        row_ms = []
+      elif kind == ROW:
+        y, spent, reports = struct.unpack("<BHH", payload)
+        row_ms.append(spent)
+        recent = row_ms[-8:]
+        eta = sum(recent) / len(recent) * max(ROWS - y, 0)
+        print("{}  row {:3d}  {:6.2f} s  {:5d} reports  eta {}".format(clock(ms), y, spent / 1000, reports, clock(int(eta))[:-4]))
+      elif kind == STATE:
+        state = STATES[payload[0]] if payload[0] < len(STATES) else str(payload[0])
+        print("{}  {}".format(clock(ms), state))
+      elif kind == LAG:
+        lags += 1
+        print("{}  lag: {:.1f} ms without a poll".format(clock(ms), struct.unpack("<I", payload)[0] / 1000))
+      elif kind == DISCONNECT:
+        print("{}  USB disconnected".format(clock(ms)))
+      elif kind == DROPPED:
+        print("{}  {} telemetry frames lost".format(clock(ms), struct.unpack("<H", payload)[0]))
+      sys.stdout.flush()
+  except KeyboardInterrupt:
+    pass
+
+  if row_ms:
+    print("{} rows, {:.2f} s per row on average, {} lag spikes".format(len(row_ms), sum(row_ms) / len(row_ms) / 1000, lags))
+
+def usage():
+  print("To follow a print live: telemetry.py /dev/ttyUSB0")
+  print("To pick the baud rate (TELEMETRY_BAUD, 115200 by default): telemetry.py -b 250000 /dev/ttyUSB0")
+  print("To decode a file saved by the simulator: telemetry.py telemetry.bin")
+
+if __name__ == "__main__":
+  main(sys.argv[1:])